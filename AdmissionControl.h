@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// What a full pool does with another task: BLOCK waits for a free slot, REJECT refuses it,
+// DROP_OLDEST sheds the oldest queued task to make room and CALLER_RUNS runs it on the calling thread.
+enum class AdmissionPolicy {
+    BLOCK, REJECT, DROP_OLDEST, CALLER_RUNS
+};
+
+enum class SubmitResult {
+    ACCEPTED, REJECTED, RAN_IN_CALLER
+};
+
+// Counts the tasks a pool holds in its queue against a capacity (0 means unbounded) and applies the
+// policy once it is reached. Pools take a slot before they push a task and give it back whenever a
+// task leaves the queue, whether it runs or is shed.
+class AdmissionControl {
+public:
+    void setLimit(const size_t &toUse, const AdmissionPolicy &policyToUse) {
+        capacity = toUse;
+        policy = policyToUse;
+        notifyWaiting();
+    }
+
+    // Never blocks: false when the queue is at capacity.
+    bool tryAcquire() {
+        size_t current = queued.load();
+        do {
+            const size_t limit = capacity;
+            if (limit != 0 && current >= limit) {
+                return false;
+            }
+        } while (!queued.compare_exchange_weak(current, current + 1));
+        size_t high = highWaterMark.load(std::memory_order_relaxed);
+        while (current + 1 > high &&
+               !highWaterMark.compare_exchange_weak(high, current + 1, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    void acquire() {
+        if (tryAcquire()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        ++waiting;
+        condition.wait(lock, [&] {
+            return tryAcquire();
+        });
+        --waiting;
+    }
+
+    void release() {
+        size_t current = queued.load();
+        while (current != 0 && !queued.compare_exchange_weak(current, current - 1)) {
+        }
+        if (waiting > 0) {
+            std::lock_guard<std::mutex> guard(mutex);
+            condition.notify_one();
+        }
+    }
+
+    // Applies the policy to one submission. push() queues the task after a slot was taken,
+    // dropOldest() sheds one queued task (returning false when there was none) and runInline() runs
+    // the task on the caller. Without mayBlock a full queue always rejects.
+    template<class Push, class DropOldest, class RunInline>
+    SubmitResult admit(const bool &mayBlock, Push &&push, DropOldest &&dropOldest, RunInline &&runInline) {
+        if (tryAcquire()) {
+            push();
+            return SubmitResult::ACCEPTED;
+        }
+        const AdmissionPolicy current = mayBlock ? policy.load() : AdmissionPolicy::REJECT;
+        switch (current) {
+            case AdmissionPolicy::BLOCK:
+                acquire();
+                push();
+                return SubmitResult::ACCEPTED;
+            case AdmissionPolicy::DROP_OLDEST:
+                while (!tryAcquire()) {
+                    if (!dropOldest()) {
+                        std::this_thread::yield();
+                    }
+                }
+                push();
+                return SubmitResult::ACCEPTED;
+            case AdmissionPolicy::CALLER_RUNS:
+                runInline();
+                return SubmitResult::RAN_IN_CALLER;
+            case AdmissionPolicy::REJECT:
+            default:
+                ++rejected;
+                return SubmitResult::REJECTED;
+        }
+    }
+
+    size_t getCapacity() const {
+        return capacity;
+    }
+
+    AdmissionPolicy getPolicy() const {
+        return policy;
+    }
+
+    size_t size() const {
+        return queued;
+    }
+
+    size_t getHighWaterMark() const {
+        return highWaterMark;
+    }
+
+    size_t getRejectedCount() const {
+        return rejected;
+    }
+
+private:
+    void notifyWaiting() {
+        std::lock_guard<std::mutex> guard(mutex);
+        condition.notify_all();
+    }
+
+    std::atomic_size_t capacity = {0};
+    std::atomic<AdmissionPolicy> policy = {AdmissionPolicy::BLOCK};
+    std::atomic_size_t queued = {0};
+    std::atomic_size_t highWaterMark = {0};
+    std::atomic_size_t rejected = {0};
+    std::atomic_size_t waiting = {0};
+    std::mutex mutex;
+    std::condition_variable condition;
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Coroutines suspended on a counter until it drops to their limit. Not synchronised: the owner keeps
+// it under the mutex guarding the counter and resumes the collected handles after unlocking.
+class AsyncWaiters {
+public:
+    void add(std::coroutine_handle<> handle, const size_t &limit) {
+        waiters.push_back({handle, limit});
+    }
+
+    // Moves up to maxCount waiters whose limit count satisfies into toResume, oldest first.
+    void collect(const size_t &count, std::vector<std::coroutine_handle<>> &toResume,
+                 const size_t &maxCount = SIZE_MAX) {
+        for (auto it = waiters.begin(); it != waiters.end() && toResume.size() < maxCount;) {
+            if (count <= it->limit) {
+                toResume.push_back(it->handle);
+                it = waiters.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    bool empty() const {
+        return waiters.empty();
+    }
+
+    static void resume(const std::vector<std::coroutine_handle<>> &toResume) {
+        for (const auto &handle: toResume) {
+            handle.resume();
+        }
+    }
+
+private:
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        size_t limit;
+    };
+
+    std::deque<Waiter> waiters;
+};
+
+// co_await of a semaphore's lockAsync()/waitAsync(); Owner::suspend decides whether to wait.
+template<class Owner>
+class SemaphoreAwaiter {
+public:
+    SemaphoreAwaiter(Owner &owner, const bool &isLock) : owner(owner), isLock(isLock) {}
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+        return owner.suspend(handle, isLock);
+    }
+
+    void await_resume() const noexcept {
+    }
+
+private:
+    Owner &owner;
+    const bool isLock;
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include "InlineTask.h"
+
+// Shared cancel flag: every copy of a token observes the same flag. A default constructed token can
+// never be cancelled and costs nothing to carry around.
+class CancellationToken {
+public:
+    static CancellationToken create() {
+        CancellationToken token;
+        token.state = std::make_shared<std::atomic_bool>(false);
+        return token;
+    }
+
+    void cancel() const {
+        if (state != nullptr) {
+            state->store(true, std::memory_order_release);
+        }
+    }
+
+    bool isCancelled() const {
+        return state != nullptr && state->load(std::memory_order_acquire);
+    }
+
+    bool canBeCancelled() const {
+        return state != nullptr;
+    }
+
+    // Token of the task running on the calling thread, for long tasks that poll for cancellation.
+    static const CancellationToken &current() {
+        return currentSlot();
+    }
+
+private:
+    friend class CancellationScope;
+
+    static CancellationToken &currentSlot() {
+        static thread_local CancellationToken token;
+        return token;
+    }
+
+    std::shared_ptr<std::atomic_bool> state;
+};
+
+// Makes the token current on this thread for the lifetime of the scope.
+class CancellationScope {
+public:
+    explicit CancellationScope(const CancellationToken &token) : previous(
+            std::move(CancellationToken::currentSlot())) {
+        CancellationToken::currentSlot() = token;
+    }
+
+    ~CancellationScope() {
+        CancellationToken::currentSlot() = std::move(previous);
+    }
+
+    CancellationScope(const CancellationScope &) = delete;
+
+    CancellationScope &operator=(const CancellationScope &) = delete;
+
+private:
+    CancellationToken previous;
+};
+
+// A queued task with the token and deadline that decide whether it still runs once dequeued.
+struct CancellableTask {
+    using Clock = std::chrono::steady_clock;
+
+    CancellableTask() = default;
+
+    explicit CancellableTask(InlineTask task, CancellationToken token = {},
+                             const Clock::time_point &deadline = Clock::time_point::max())
+            : task(std::move(task)), token(std::move(token)), deadline(deadline) {}
+
+    bool expired() const {
+        return token.isCancelled() || (deadline != Clock::time_point::max() && Clock::now() >= deadline);
+    }
+
+    // Runs the task with its token as the current token, for pools that run it themselves.
+    void run() {
+        const CancellationScope scope(token);
+        task();
+    }
+
+    InlineTask task;
+    // Goes to the worker next to the task (Worker::cancelWith); a task wrapped together with its
+    // token would outgrow InlineTask's inline buffer.
+    CancellationToken token;
+    Clock::time_point deadline = Clock::time_point::max();
+#ifdef FLOW_POOL_METRICS
+    // PoolMetrics::taskQueued() timestamp, for the worker that runs the task.
+    uint64_t queuedAt = 0;
+#endif
+};
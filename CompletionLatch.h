@@ -0,0 +1,157 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include "Futex.h"
+#include "MultiSemaphore.h"
+
+// Pending work counter with the addLock/unlock/wait/count interface the pools use on MultiSemaphore.
+// Counting up and down is a single atomic operation; only the decrement that reaches zero touches the
+// wake word, and it issues one futex wake (or notify_all where futexes are unavailable) and only
+// when somebody waits. Like MultiSemaphore, unlock() on zero does nothing and wait() returns once
+// the count was observed at zero.
+class CompletionLatch {
+public:
+    void addLock(const size_t &count = 1) {
+        pending.fetch_add(count);
+    }
+
+    void unlock() {
+        size_t current = pending.load();
+        while (current != 0 && !pending.compare_exchange_weak(current, current - 1)) {
+        }
+        if (current == 1) {
+            ++generation;
+            if (waiting.load() != 0) {
+                wakeAll();
+            }
+        }
+    }
+
+    void wait() {
+        while (pending.load() != 0) {
+            const uint32_t seen = generation.load();
+            ++waiting;
+            // Re-checked after registering, so the decrement to zero either is seen here or sees us.
+            if (pending.load() == 0) {
+                --waiting;
+                return;
+            }
+#ifdef FLOW_HAS_FUTEX
+            FlowFutex::wait(generation, seen);
+#else
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&] {
+                    return generation.load() != seen;
+                });
+            }
+#endif
+            --waiting;
+        }
+    }
+
+    size_t count() const {
+        return pending.load();
+    }
+
+private:
+    void wakeAll() {
+#ifdef FLOW_HAS_FUTEX
+        FlowFutex::wakeAll(generation);
+#else
+        std::lock_guard<std::mutex> guard(mutex);
+        condition.notify_all();
+#endif
+    }
+
+    std::atomic_size_t pending = {0};
+    std::atomic<uint32_t> generation = {0};
+    std::atomic<uint32_t> waiting = {0};
+#ifndef FLOW_HAS_FUTEX
+    std::mutex mutex;
+    std::condition_variable condition;
+#endif
+};
+
+// Reusable barrier with the std::barrier interface: each phase completes once the expected number of
+// threads arrived, the last one runs the completion function and then every waiter of the phase is
+// released with a single wake. arrive_and_drop() also lowers the expected count for later phases.
+class PhaseBarrier {
+public:
+    using ArrivalToken = uint32_t;
+
+    explicit PhaseBarrier(const ptrdiff_t &expected, std::function<void()> completion = {})
+            : expected(expected), remaining(expected), completion(std::move(completion)) {}
+
+    PhaseBarrier(const PhaseBarrier &) = delete;
+
+    PhaseBarrier &operator=(const PhaseBarrier &) = delete;
+
+    [[nodiscard]] ArrivalToken arrive(const ptrdiff_t &count = 1) {
+        const ArrivalToken current = phase.load();
+        if (remaining.fetch_sub(count) == count) {
+            if (completion) {
+                completion();
+            }
+            remaining = expected.load();
+            ++phase;
+            wakeAll();
+        }
+        return current;
+    }
+
+    // Blocks until the phase the token was returned for has completed.
+    void wait(const ArrivalToken &token) const {
+        while (phase.load() == token) {
+#ifdef FLOW_HAS_FUTEX
+            FlowFutex::wait(phase, token);
+#else
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] {
+                return phase.load() != token;
+            });
+#endif
+        }
+    }
+
+    void arrive_and_wait() {
+        wait(arrive());
+    }
+
+    void arrive_and_drop() {
+        --expected;
+        (void) arrive();
+    }
+
+private:
+    void wakeAll() {
+#ifdef FLOW_HAS_FUTEX
+        FlowFutex::wakeAll(phase);
+#else
+        std::lock_guard<std::mutex> guard(mutex);
+        condition.notify_all();
+#endif
+    }
+
+    std::atomic<ptrdiff_t> expected;
+    std::atomic<ptrdiff_t> remaining;
+    mutable std::atomic<uint32_t> phase = {0};
+    std::function<void()> completion;
+#ifndef FLOW_HAS_FUTEX
+    mutable std::mutex mutex;
+    mutable std::condition_variable condition;
+#endif
+};
+
+// The pools count their pending tasks with this; FLOW_USE_COMPLETION_LATCH switches them over from
+// MultiSemaphore.
+#ifdef FLOW_USE_COMPLETION_LATCH
+using PendingTasks = CompletionLatch;
+#else
+using PendingTasks = MultiSemaphore;
+#endif
@@ -1,13 +1,21 @@
 #pragma once
 
+#include <atomic>
 #include <thread>
 #include <functional>
 #include "Semaphore.h"
+#include "InlineTask.h"
+#include "FlowAffinity.h"
+#include "PoolMetrics.h"
 
 //enum TemplatedWorkerState {
 //    IDLE, RUNNING, STOPPED
 //};
 
+// Tasks get the worker's context by reference, so it is neither copied per task nor shared.
+template<class ContextType>
+using ContextTask = InlineFunction<void(ContextType &)>;
+
 template<class ContextType>
 class ContextWorker {
 public:
@@ -22,21 +30,57 @@ public:
     }
 
     void assignTask(std::shared_ptr<std::function<void(ContextType)>> task) {
-        currentTask = task;
+        assignTask(ContextTask<ContextType>([task](ContextType &context) {
+            (*task)(context);
+        }));
+    }
+
+    void assignTask(ContextTask<ContextType> task) {
+        currentTask = std::move(task);
+        assigned.store(true, std::memory_order_release);
         runTask();
     }
 
+#ifdef FLOW_POOL_METRICS
+
+    // The next task's wait and run time go to metrics; queuedAt is its PoolMetrics::taskQueued() stamp.
+    void trackNext(PoolMetrics &poolMetrics, const uint64_t &taskQueuedAt) {
+        metrics = &poolMetrics;
+        queuedAt = taskQueuedAt;
+    }
+
+#endif
+
     const size_t getId() {
         return id;
     }
 
+    // Binds the worker thread according to the placement; returns false when it stays unbound.
+    bool pin(const FlowAffinity::Placement &toPin) {
+        placement = toPin;
+        return FlowAffinity::pin(mainThread, placement);
+    }
+
+    // Cpu the worker is pinned to, -1 when it is unbound or bound to a whole node.
+    int getCpu() const {
+        return placement.cpu;
+    }
+
+    // Index into FlowAffinity::Topology::nodes, -1 when the worker is unbound.
+    int getNode() const {
+        return placement.node;
+    }
+
     void stop() {
         state = STOPPED;
         mainSemaphore.unlock();
     }
 
+    // A no-op on the worker's own thread, which cannot join itself.
     void join() {
-        mainThread.join();
+        if (mainThread.joinable() && mainThread.get_id() != std::this_thread::get_id()) {
+            mainThread.join();
+        }
     }
 
     void detach() {
@@ -51,7 +95,7 @@ public:
         onStopCallback = callback;
     }
 
-    WorkerState state = IDLE;
+    std::atomic<WorkerState> state = {IDLE};
 
     ContextType context;
     const std::size_t id;
@@ -60,23 +104,40 @@ protected:
         return std::thread([&] {
             while (state != STOPPED) {
                 mainSemaphore.lock();
-                if(currentTask == nullptr){
+                // A wake without a task (the first lock(), stop) leaves currentTask to assignTask.
+                if (!assigned.load(std::memory_order_acquire)) {
                     continue;
                 }
                 if (state == STOPPED) {
                     fireStopCallback();
                     return;
                 }
-                currentTask->operator()(context);
+                runCurrentTask();
                 currentTask = nullptr;
-                state = IDLE;
+                assigned.store(false, std::memory_order_relaxed);
+                // A stop() that arrived during the run wins; overwriting it would park the worker for good.
+                WorkerState running = RUNNING;
+                state.compare_exchange_strong(running, IDLE);
                 fireIdleCallback();
             }
         });
     }
 
+    void runCurrentTask() {
+#ifdef FLOW_POOL_METRICS
+        if (metrics != nullptr) {
+            metrics->run(queuedAt, currentTask, context);
+            metrics = nullptr;
+            return;
+        }
+#endif
+        currentTask(context);
+    }
+
+    // A stopped worker stays stopped and hands the task back through the stop callback.
     void runTask() {
-        state = RUNNING;
+        WorkerState idle = IDLE;
+        state.compare_exchange_strong(idle, RUNNING);
         mainSemaphore.unlock();
     }
 
@@ -92,9 +153,15 @@ protected:
         }
     }
 
+    FlowAffinity::Placement placement;
     Semaphore mainSemaphore;
+    std::atomic_bool assigned = {false};
     std::thread mainThread;
-    std::shared_ptr<std::function<void(ContextType context)>> currentTask;
+    ContextTask<ContextType> currentTask;
+#ifdef FLOW_POOL_METRICS
+    PoolMetrics *metrics = nullptr;
+    uint64_t queuedAt = 0;
+#endif
     std::shared_ptr<std::function<void(ContextWorker *worker)>> onIdleCallback;
     std::shared_ptr<std::function<void(ContextWorker *worker)>> onStopCallback;
 };
\ No newline at end of file
@@ -4,40 +4,149 @@
 #include <memory>
 #include <functional>
 #include <mutex>
-#include "MultiSemaphore.h"
+#include "CompletionLatch.h"
 #include <queue>
+#include "TaskQueue.h"
 #include "FlowLog.h"
 #include "ContextWorker.h"
+#include "FlowAffinity.h"
+#include "PoolMetrics.h"
+#include "AdmissionControl.h"
+#include "FlowTask.h"
 #include <functional>
 #include <map>
+#include <span>
+#include <vector>
 
 template<class ContextType>
 class ContextWorkerPool {
 public:
-    ContextWorkerPool(const std::vector<std::shared_ptr<ContextWorker<ContextType>>>& worker) : workerCount(worker.size()) {
-        for(auto& item : worker) {
-            registerWorker(item);
+    ContextWorkerPool(const std::vector<std::shared_ptr<ContextWorker<ContextType>>>& worker,
+                      const TaskStore &store = TaskStore::LOCKED_QUEUE,
+                      const size_t &capacity = 4096,
+                      const FlowAffinity::AffinityPolicy &affinity = {}) : tasks(store, capacity), workerCount(worker.size()) {
+        const auto &topology = FlowAffinity::Topology::get();
+        for (size_t i = 0; i < worker.size(); ++i) {
+            worker[i]->pin(topology.place(affinity, i));
+            registerWorker(worker[i]);
         }
     }
-    ContextWorkerPool(const size_t &workerCount = std::thread::hardware_concurrency()) : workerCount(workerCount) {
+    ContextWorkerPool(const size_t &workerCount = std::thread::hardware_concurrency(),
+                      const TaskStore &store = TaskStore::LOCKED_QUEUE,
+                      const size_t &capacity = 4096,
+                      const FlowAffinity::AffinityPolicy &affinity = {}) : tasks(store, capacity), workerCount(workerCount) {
+        const auto &topology = FlowAffinity::Topology::get();
         for (int i = 0; i < workerCount; ++i) {
             auto worker = std::make_shared<ContextWorker<ContextType>>(workerId++);
+            worker->pin(topology.place(affinity, i));
             registerWorker(worker);
         }
     }
 
+    // Joins the workers before any member goes: a worker finishing its last task still runs the idle
+    // callback, which touches idleWorker and the task store. Workers handed in are joined too, since
+    // their callbacks point at this pool.
     ~ContextWorkerPool() {
         stop();
+        for (const auto &entry: workerMap) {
+            entry.second->join();
+        }
     }
 
     void wait() {
         toWaitFor.wait();
     }
 
-    void addTask(std::shared_ptr<std::function<void(ContextType)>> function) {
-        std::lock_guard guard(tasksMutex);
-        tasks.emplace(function);
-        toWaitFor.addLock();
+    SubmitResult addTask(std::shared_ptr<std::function<void(ContextType)>> function) {
+        return addTask(ContextTask<ContextType>([function](ContextType &context) {
+            (*function)(context);
+        }));
+    }
+
+    // Applies the admission policy once the queue is full, see setAdmission.
+    SubmitResult addTask(ContextTask<ContextType> function) {
+        return submit(std::move(function), true);
+    }
+
+    // Never blocks: a full queue rejects the task whatever the policy.
+    SubmitResult trySubmit(ContextTask<ContextType> function) {
+        return submit(std::move(function), false);
+    }
+
+    // ContextType &context = co_await pool.schedule(); continues the coroutine on a worker and hands
+    // it that worker's context, valid until the coroutine suspends again.
+    auto schedule() {
+        class Awaiter {
+        public:
+            explicit Awaiter(ContextWorkerPool &pool) : pool(pool) {}
+
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            // A rejected or shed task resumes the coroutine with an error, see FlowCoroutine::PendingResume.
+            bool await_suspend(std::coroutine_handle<> handle) {
+                ContextWorkerPool &owner = pool;
+                const FlowCoroutine::InlineSubmit inlineSubmit(handle);
+                owner.addTask(ContextTask<ContextType>(
+                        [this, resume = FlowCoroutine::PendingResume(handle, &error)](
+                                ContextType &workerContext) mutable {
+                            context = &workerContext;
+                            resume.resume();
+                        }));
+                if (inlineSubmit.completed()) {
+                    return false;
+                }
+                owner.start();
+                return true;
+            }
+
+            ContextType &await_resume() const {
+                if (error != nullptr) {
+                    std::rethrow_exception(error);
+                }
+                return *context;
+            }
+
+        private:
+            ContextWorkerPool &pool;
+            ContextType *context = nullptr;
+            std::exception_ptr error;
+        };
+        return Awaiter(*this);
+    }
+
+    // Caps the number of queued entries (0 means unbounded, the default; a batch counts once) and
+    // picks what addTask does once the cap is reached. The caller has no worker context to run a
+    // task with, so CALLER_RUNS blocks like BLOCK.
+    void setAdmission(const size_t &capacity, const AdmissionPolicy &policy = AdmissionPolicy::BLOCK) {
+        admission.setLimit(capacity, policy == AdmissionPolicy::CALLER_RUNS ? AdmissionPolicy::BLOCK : policy);
+    }
+
+    size_t getHighWaterMark() const {
+        return admission.getHighWaterMark();
+    }
+
+    size_t getRejectedCount() const {
+        return admission.getRejectedCount();
+    }
+
+    // Moves the tasks out of batch into a single queue entry: one push, and one worker runs all of them
+    // in order after a single wake up.
+    SubmitResult addTasks(std::span<ContextTask<ContextType>> batch) {
+        if (batch.empty()) {
+            return SubmitResult::ACCEPTED;
+        }
+        std::vector<ContextTask<ContextType>> toRun;
+        toRun.reserve(batch.size());
+        for (auto &task: batch) {
+            toRun.emplace_back(std::move(task));
+        }
+        return addTask(ContextTask<ContextType>([toRun = std::move(toRun)](ContextType &context) mutable {
+            for (auto &task: toRun) {
+                task(context);
+            }
+        }));
     }
 
     void stop() {
@@ -54,6 +163,23 @@ public:
         }
     }
 
+    // Where the worker with that id is pinned; a default Placement for unknown ids.
+    FlowAffinity::Placement getPlacement(const size_t &id) const {
+        const auto entry = workerMap.find(id);
+        if (entry == workerMap.end()) {
+            return {};
+        }
+        return {entry->second->getCpu(), entry->second->getNode()};
+    }
+
+#ifdef FLOW_POOL_METRICS
+
+    PoolMetricsSnapshot getMetrics() const {
+        return metrics.snapshot();
+    }
+
+#endif
+
     void join() {
         isJoin = true;
         while (!tasks.empty()) {
@@ -66,8 +192,55 @@ public:
     }
 
 private:
+    // A queued task with the PoolMetrics::taskQueued() stamp its worker records the wait time against.
+    struct QueuedTask {
+        ContextTask<ContextType> task;
+#ifdef FLOW_POOL_METRICS
+        uint64_t queuedAt = 0;
+#endif
+    };
+
+    SubmitResult submit(ContextTask<ContextType> function, const bool &mayBlock) {
+        QueuedTask entry{std::move(function)};
+#ifdef FLOW_POOL_METRICS
+        entry.queuedAt = metrics.taskQueued();
+#endif
+        const size_t capacity = admission.getCapacity();
+        if (capacity != 0 && admission.size() >= capacity) {
+            start();
+        }
+        const SubmitResult result = admission.admit(mayBlock, [&] {
+            toWaitFor.addLock();
+            while (!tasks.tryPush(std::move(entry))) {
+                start();
+                std::this_thread::yield();
+            }
+        }, [&] {
+            QueuedTask oldest;
+            if (!tasks.tryPop(oldest)) {
+                return false;
+            }
+            admission.release();
+            toWaitFor.unlock();
+#ifdef FLOW_POOL_METRICS
+            metrics.taskDiscarded();
+#endif
+            return true;
+        }, [] {
+        });
+#ifdef FLOW_POOL_METRICS
+        if (result == SubmitResult::REJECTED) {
+            metrics.taskDiscarded();
+        }
+#endif
+        return result;
+    }
+
     void registerWorker(const std::shared_ptr<ContextWorker<ContextType>>& worker) {
         workerMap[worker->id] = worker;
+#ifdef FLOW_POOL_METRICS
+        metrics.setWorkers(workerMap.size());
+#endif
         const auto onIdleCallback = std::make_shared<std::function<void(ContextWorker<ContextType> *worker)>>([&](ContextWorker<ContextType> *worker) {
             std::unique_lock<std::mutex> lock(poolMutex);
             toWaitFor.unlock();
@@ -88,17 +261,19 @@ private:
 
     void startWorker() {
         std::lock_guard guard(tasksMutex);
-        while (!tasks.empty() && !idleWorker.empty()) {
+        QueuedTask toRun;
+        while (!idleWorker.empty() && tasks.tryPop(toRun)) {
+            admission.release();
             try {
-                const auto toRun = tasks.front();
-                tasks.pop();
                 const auto worker = idleWorker.front();
                 idleWorker.pop();
-                worker->assignTask(toRun);
+#ifdef FLOW_POOL_METRICS
+                worker->trackNext(metrics, toRun.queuedAt);
+#endif
+                worker->assignTask(std::move(toRun.task));
             } catch (const std::system_error &e) {
                 LOG_WARNING << "Code " << e.code()
                             << " meaning " << e.what() << '\n';
-                tasks.pop();
                 toWaitFor.unlock();
             }
         }
@@ -109,14 +284,19 @@ private:
         }
     }
 
-    bool isStopping = false;
-    bool isJoin = false;
+    std::atomic_bool isStopping = {false};
+    std::atomic_bool isJoin = {false};
     std::atomic_size_t workerId;
-    std::queue<std::shared_ptr<std::function<void(ContextType)>>> tasks;
-    MultiSemaphore toWaitFor;
+    TaskQueue<QueuedTask> tasks;
+    AdmissionControl admission;
+    PendingTasks toWaitFor;
     std::mutex poolMutex;
     std::mutex tasksMutex;
     size_t workerCount;
+    // Ahead of the worker containers, whose destruction joins workers that may still be running a task.
+#ifdef FLOW_POOL_METRICS
+    PoolMetrics metrics;
+#endif
     std::queue<std::shared_ptr<ContextWorker<ContextType>>> idleWorker;
     std::unordered_map<size_t, std::shared_ptr<ContextWorker<ContextType>>> workerMap;
 };
\ No newline at end of file
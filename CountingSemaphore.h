@@ -0,0 +1,130 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "Futex.h"
+
+// Counting semaphore with the std::counting_semaphore interface. Unlike Semaphore the count is not
+// clamped: every release() adds a permit and wakes at most one sleeping waiter per permit. acquire()
+// takes a permit with a single CAS when one is available, spins for the configured window and only
+// then sleeps on a futex (or a condition variable where futexes are unavailable). release() only
+// enters the kernel when somebody is asleep.
+class CountingSemaphore {
+public:
+    static constexpr std::chrono::nanoseconds defaultSpinWindow = std::chrono::microseconds(10);
+
+    explicit CountingSemaphore(const uint32_t &initial = 0,
+                               const std::chrono::nanoseconds &spinWindow = defaultSpinWindow)
+            : count(initial), spinWindow(spinWindow) {}
+
+    CountingSemaphore(const CountingSemaphore &) = delete;
+
+    CountingSemaphore &operator=(const CountingSemaphore &) = delete;
+
+    void setSpinWindow(const std::chrono::nanoseconds &window) {
+        spinWindow = window;
+    }
+
+    void release(const uint32_t &permits = 1) {
+        count.fetch_add(permits);
+        if (sleeping.load() == 0) {
+            return;
+        }
+#ifdef FLOW_HAS_FUTEX
+        FlowFutex::wake(count, static_cast<int>(permits));
+#else
+        std::lock_guard<std::mutex> guard(mutex);
+        for (uint32_t i = 0; i < permits; ++i) {
+            condition.notify_one();
+        }
+#endif
+    }
+
+    bool try_acquire() {
+        uint32_t current = count.load(std::memory_order_relaxed);
+        while (current != 0) {
+            if (count.compare_exchange_weak(current, current - 1, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void acquire() {
+        acquireUntil(std::chrono::steady_clock::time_point::max());
+    }
+
+    // Returns false when the timeout expired without a permit.
+    template<class Rep, class Period>
+    bool try_acquire_for(const std::chrono::duration<Rep, Period> &timeout) {
+        return acquireUntil(std::chrono::steady_clock::now() +
+                            std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    }
+
+    template<class Clock, class Duration>
+    bool try_acquire_until(const std::chrono::time_point<Clock, Duration> &deadline) {
+        return try_acquire_for(deadline - Clock::now());
+    }
+
+    // Permits currently available; only a snapshot while other threads acquire or release.
+    uint32_t available() const {
+        return count.load();
+    }
+
+private:
+    bool acquireUntil(const std::chrono::steady_clock::time_point &deadline) {
+        if (try_acquire()) {
+            return true;
+        }
+        const std::chrono::nanoseconds window = spinWindow;
+        if (window > std::chrono::nanoseconds::zero()) {
+            const auto spinEnd = std::min(deadline, std::chrono::steady_clock::now() + window);
+            do {
+                if (try_acquire()) {
+                    return true;
+                }
+                std::this_thread::yield();
+            } while (std::chrono::steady_clock::now() < spinEnd);
+        }
+        const bool infinite = deadline == std::chrono::steady_clock::time_point::max();
+        // Registered before the count is checked again, so a release() in between sees the sleeper.
+        ++sleeping;
+        while (!try_acquire()) {
+            if (!infinite && std::chrono::steady_clock::now() >= deadline) {
+                --sleeping;
+                return false;
+            }
+#ifdef FLOW_HAS_FUTEX
+            if (infinite) {
+                FlowFutex::wait(count, 0);
+            } else {
+                FlowFutex::waitFor(count, 0, deadline - std::chrono::steady_clock::now());
+            }
+#else
+            std::unique_lock<std::mutex> lock(mutex);
+            const auto ready = [&] { return count.load() != 0; };
+            if (infinite) {
+                condition.wait(lock, ready);
+            } else {
+                condition.wait_until(lock, deadline, ready);
+            }
+#endif
+        }
+        --sleeping;
+        return true;
+    }
+
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> sleeping = {0};
+    std::atomic<std::chrono::nanoseconds> spinWindow;
+#ifndef FLOW_HAS_FUTEX
+    std::mutex mutex;
+    std::condition_variable condition;
+#endif
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+
+#include <pthread.h>
+#include <sched.h>
+
+#endif
+
+namespace FlowAffinity {
+    enum class Policy {
+        NONE, COMPACT, SCATTER, EXPLICIT, NUMA_NODES
+    };
+
+    // COMPACT fills the cpus of one node before moving to the next, SCATTER round-robins workers over
+    // the nodes, EXPLICIT pins worker i to cpus[i % cpus.size()] and NUMA_NODES spreads workers evenly
+    // over the nodes and lets each float within its node's cpus.
+    struct AffinityPolicy {
+        Policy policy = Policy::NONE;
+        std::vector<int> cpus;
+
+        static AffinityPolicy compact() {
+            return {Policy::COMPACT, {}};
+        }
+
+        static AffinityPolicy scatter() {
+            return {Policy::SCATTER, {}};
+        }
+
+        static AffinityPolicy explicitCpus(std::vector<int> cpus) {
+            return {Policy::EXPLICIT, std::move(cpus)};
+        }
+
+        static AffinityPolicy numaNodes() {
+            return {Policy::NUMA_NODES, {}};
+        }
+    };
+
+    // cpu is -1 when the worker is bound to a whole node (or not bound at all), node is the index into
+    // Topology::nodes and -1 when the worker is not bound.
+    struct Placement {
+        int cpu = -1;
+        int node = -1;
+    };
+
+    struct Node {
+        int id = 0;
+        std::vector<int> cpus;
+    };
+
+    inline std::vector<int> parseCpuList(const std::string &list) {
+        std::vector<int> cpus;
+        size_t position = 0;
+        while (position < list.size()) {
+            size_t end = list.find(',', position);
+            if (end == std::string::npos) {
+                end = list.size();
+            }
+            const std::string range = list.substr(position, end - position);
+            const size_t dash = range.find('-');
+            try {
+                if (dash == std::string::npos) {
+                    if (!range.empty() && range != "\n") {
+                        cpus.emplace_back(std::stoi(range));
+                    }
+                } else {
+                    const int first = std::stoi(range.substr(0, dash));
+                    const int last = std::stoi(range.substr(dash + 1));
+                    for (int cpu = first; cpu <= last; ++cpu) {
+                        cpus.emplace_back(cpu);
+                    }
+                }
+            } catch (const std::exception &) {
+            }
+            position = end + 1;
+        }
+        return cpus;
+    }
+
+    // CPUs this process may run on (sched_getaffinity) grouped by NUMA node (/sys/devices/system/node).
+    // Without NUMA information every allowed cpu lands in a single node 0.
+    class Topology {
+    public:
+        static const Topology &get() {
+            static const Topology topology = read();
+            return topology;
+        }
+
+        static Topology read() {
+            Topology topology;
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+                for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                    if (CPU_ISSET(cpu, &set)) {
+                        topology.allowedCpus.emplace_back(cpu);
+                    }
+                }
+            }
+            std::error_code ec;
+            for (const auto &entry: std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+                const std::string name = entry.path().filename().string();
+                if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+                    !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+                    continue;
+                }
+                std::ifstream file(entry.path() / "cpulist");
+                std::string list;
+                std::getline(file, list);
+                Node node;
+                node.id = std::stoi(name.substr(4));
+                for (const int cpu: parseCpuList(list)) {
+                    if (topology.isAllowed(cpu)) {
+                        node.cpus.emplace_back(cpu);
+                    }
+                }
+                if (!node.cpus.empty()) {
+                    topology.nodes.emplace_back(std::move(node));
+                }
+            }
+#endif
+            if (topology.allowedCpus.empty()) {
+                for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+                    topology.allowedCpus.emplace_back(static_cast<int>(cpu));
+                }
+            }
+            if (topology.nodes.empty()) {
+                topology.nodes.push_back({0, topology.allowedCpus});
+            }
+            std::sort(topology.nodes.begin(), topology.nodes.end(), [](const Node &a, const Node &b) {
+                return a.id < b.id;
+            });
+            const int maxCpu = *std::max_element(topology.allowedCpus.begin(), topology.allowedCpus.end());
+            topology.cpuNode.assign(maxCpu + 1, 0);
+            for (size_t i = 0; i < topology.nodes.size(); ++i) {
+                for (const int cpu: topology.nodes[i].cpus) {
+                    topology.cpuNode[cpu] = static_cast<int>(i);
+                }
+            }
+            return topology;
+        }
+
+        bool isAllowed(const int cpu) const {
+            return std::find(allowedCpus.begin(), allowedCpus.end(), cpu) != allowedCpus.end();
+        }
+
+        // Node index of a cpu, 0 for cpus outside the allowed set.
+        int nodeOf(const int cpu) const {
+            return cpu >= 0 && static_cast<size_t>(cpu) < cpuNode.size() ? cpuNode[cpu] : 0;
+        }
+
+        Placement place(const AffinityPolicy &affinity, const size_t &workerIndex) const {
+            switch (affinity.policy) {
+                case Policy::COMPACT: {
+                    size_t index = workerIndex % allowedCpus.size();
+                    for (size_t node = 0; node < nodes.size(); ++node) {
+                        if (index < nodes[node].cpus.size()) {
+                            return {nodes[node].cpus[index], static_cast<int>(node)};
+                        }
+                        index -= nodes[node].cpus.size();
+                    }
+                    return {};
+                }
+                case Policy::SCATTER: {
+                    const size_t node = workerIndex % nodes.size();
+                    const auto &cpus = nodes[node].cpus;
+                    return {cpus[(workerIndex / nodes.size()) % cpus.size()], static_cast<int>(node)};
+                }
+                case Policy::EXPLICIT: {
+                    if (affinity.cpus.empty()) {
+                        return {};
+                    }
+                    const int cpu = affinity.cpus[workerIndex % affinity.cpus.size()];
+                    return {cpu, nodeOf(cpu)};
+                }
+                case Policy::NUMA_NODES:
+                    return {-1, static_cast<int>(workerIndex % nodes.size())};
+                case Policy::NONE:
+                default:
+                    return {};
+            }
+        }
+
+        std::vector<int> allowedCpus;
+        std::vector<Node> nodes;
+
+    private:
+        std::vector<int> cpuNode;
+    };
+
+    // Binds the thread to the placement's cpu, or to all cpus of its node when cpu is -1.
+    inline bool pin(std::thread &thread, const Placement &placement) {
+#ifdef __linux__
+        if (placement.cpu < 0 && placement.node < 0) {
+            return false;
+        }
+        const auto &topology = Topology::get();
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (placement.cpu >= 0) {
+            CPU_SET(placement.cpu, &set);
+        } else if (static_cast<size_t>(placement.node) < topology.nodes.size()) {
+            for (const int cpu: topology.nodes[placement.node].cpus) {
+                CPU_SET(cpu, &set);
+            }
+        } else {
+            return false;
+        }
+        return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+        return false;
+#endif
+    }
+
+    // Node index of the cpu the calling thread currently runs on.
+    inline int currentNode() {
+#ifdef __linux__
+        return Topology::get().nodeOf(sched_getcpu());
+#else
+        return 0;
+#endif
+    }
+}
@@ -17,6 +17,21 @@
 #include <mutex>
 #include <fstream>
 #include <memory>
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#ifndef _WIN32
+
+#include <cerrno>
+#include <climits>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#endif
 
 #ifdef ERROR
 #undef ERROR
@@ -33,8 +48,11 @@ namespace logging {
             this->level = level;
         }
 
+        // Truncates the file, then appends, so the async writer can append to it as well.
         void setLogFile(const std::string &logFile) {
-            _logFile = std::make_shared<std::ofstream>(logFile.c_str());
+            std::ofstream(logFile.c_str()).close();
+            _logFile = std::make_shared<std::ofstream>(logFile.c_str(), std::ios::app);
+            _logFilePath = logFile;
         }
 
         logging::severity getLevel() const {
@@ -45,6 +63,10 @@ namespace logging {
             return _logFile;
         }
 
+        std::string getLogFilePath() const {
+            return _logFilePath;
+        }
+
         static std::shared_ptr<logging::config> getInstance() {
             if (!_instance)
                 _instance = std::make_shared<logging::config>();
@@ -69,6 +91,7 @@ namespace logging {
         static std::shared_ptr<config> _instance;
         logging::severity level;
         std::shared_ptr<std::ofstream> _logFile;
+        std::string _logFilePath;
     };
 
     inline std::shared_ptr<logging::config> logging::config::_instance;
@@ -79,6 +102,317 @@ namespace logging {
 
     static std::mutex loggingMutex;
 
+    // What a thread does when its async queue is full.
+    enum class overflow {
+        BLOCK, DROP
+    };
+
+    struct asyncOptions {
+        // Records queued per thread; rounded up to a power of two when the thread first logs.
+        size_t queueCapacity = 4096;
+        overflow onOverflow = overflow::BLOCK;
+        // The writer wakes at least this often, earlier when a queue holds flushThreshold records or
+        // a record of flushLevel or worse arrives.
+        std::chrono::milliseconds flushInterval{50};
+        size_t flushThreshold = 256;
+        severity flushLevel = WARNING;
+        // fdatasync the log file after every batch (not on Windows).
+        bool syncFile = false;
+    };
+
+    inline std::atomic_bool asyncEnabled = {false};
+
+    // Background writer for async mode. Every logging thread owns a single producer queue of finished
+    // lines, so logging neither locks nor does I/O; the writer drains all queues and writes each batch
+    // with one writev() per destination. Lines from one thread stay in order, lines of different
+    // threads are only ordered per batch.
+    class asyncWriter {
+    public:
+        static asyncWriter &getInstance() {
+            static asyncWriter instance;
+            return instance;
+        }
+
+        void start(const asyncOptions &options) {
+            stop();
+            std::scoped_lock guard(mutex, queuesMutex);
+            this->options = options;
+            stopping = false;
+            std::cout.flush();
+            std::cerr.flush();
+            writer = std::thread([this] {
+                run();
+            });
+            active.store(true);
+            asyncEnabled.store(true);
+        }
+
+        // Writes everything queued so far, then returns logging to the synchronous path.
+        void stop() {
+            asyncEnabled.store(false);
+            if (!active.exchange(false)) {
+                return;
+            }
+            // A thread that saw the writer active finishes its push first.
+            for (const auto &queue: snapshot()) {
+                while (queue->busy.load()) {
+                    std::this_thread::yield();
+                }
+            }
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            writer.join();
+        }
+
+        // False when async mode is off and the caller has to write the line itself.
+        bool push(const severity &level, std::string &&text) {
+            lineQueue &local = localQueue();
+            local.busy.store(true);
+            if (!active.load()) {
+                local.busy.store(false);
+                return false;
+            }
+            const size_t position = local.head.load(std::memory_order_relaxed);
+            while (position - local.tail.load(std::memory_order_acquire) == local.capacity) {
+                if (options.onOverflow == overflow::DROP) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    local.busy.store(false);
+                    return true;
+                }
+                wake();
+                std::this_thread::yield();
+            }
+            local.records[position & (local.capacity - 1)] = {level, std::move(text)};
+            local.head.store(position + 1, std::memory_order_release);
+            if (level >= options.flushLevel ||
+                position + 1 - local.tail.load(std::memory_order_relaxed) >= options.flushThreshold) {
+                wake();
+            }
+            local.busy.store(false);
+            return true;
+        }
+
+        // Blocks until every line logged before the call is written.
+        void flush() {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!active.load()) {
+                return;
+            }
+            const uint64_t requested = ++flushRequests;
+            condition.notify_all();
+            flushedCondition.wait(lock, [&] {
+                return flushed >= requested || stopping;
+            });
+        }
+
+        uint64_t getDroppedCount() const {
+            return dropped.load(std::memory_order_relaxed);
+        }
+
+        ~asyncWriter() {
+            stop();
+#ifndef _WIN32
+            if (fileDescriptor >= 0) {
+                ::close(fileDescriptor);
+            }
+#endif
+        }
+
+    private:
+        struct record {
+            severity level;
+            std::string text;
+        };
+
+        struct lineQueue {
+            explicit lineQueue(const size_t &capacity) : capacity(capacity), records(new record[capacity]) {}
+
+            const size_t capacity;
+            std::unique_ptr<record[]> records;
+            alignas(64) std::atomic_size_t head = {0};
+            alignas(64) std::atomic_size_t tail = {0};
+            std::atomic_bool busy = {false};
+            std::atomic_bool retired = {false};
+        };
+
+        asyncWriter() = default;
+
+        lineQueue &localQueue() {
+            struct owner {
+                std::shared_ptr<lineQueue> local;
+
+                ~owner() {
+                    local->retired.store(true);
+                }
+            };
+            static thread_local owner threadQueue{getInstance().registerQueue()};
+            return *threadQueue.local;
+        }
+
+        std::shared_ptr<lineQueue> registerQueue() {
+            std::lock_guard<std::mutex> guard(queuesMutex);
+            size_t capacity = 1;
+            while (capacity < options.queueCapacity) {
+                capacity <<= 1;
+            }
+            queues.push_back(std::make_shared<lineQueue>(capacity));
+            return queues.back();
+        }
+
+        std::vector<std::shared_ptr<lineQueue>> snapshot() {
+            std::lock_guard<std::mutex> guard(queuesMutex);
+            return queues;
+        }
+
+        void wake() {
+            pending.store(true);
+            condition.notify_one();
+        }
+
+        void run() {
+            std::vector<record> batch;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                const bool finished = stopping;
+                const uint64_t requested = flushRequests;
+                pending.store(false);
+                lock.unlock();
+                drain(batch);
+                lock.lock();
+                flushed = requested;
+                flushedCondition.notify_all();
+                if (finished) {
+                    return;
+                }
+                condition.wait_for(lock, options.flushInterval, [&] {
+                    return stopping || pending.load() || flushRequests != requested;
+                });
+            }
+        }
+
+        void drain(std::vector<record> &batch) {
+            for (const auto &queue: snapshot()) {
+                const bool retired = queue->retired.load();
+                const size_t end = queue->head.load(std::memory_order_acquire);
+                size_t position = queue->tail.load(std::memory_order_relaxed);
+                for (; position != end; ++position) {
+                    batch.push_back(std::move(queue->records[position & (queue->capacity - 1)]));
+                }
+                queue->tail.store(position, std::memory_order_release);
+                if (retired) {
+                    std::lock_guard<std::mutex> guard(queuesMutex);
+                    queues.erase(std::find(queues.begin(), queues.end(), queue));
+                }
+            }
+            if (!batch.empty()) {
+                write(batch);
+                batch.clear();
+            }
+        }
+
+#ifndef _WIN32
+
+        void write(const std::vector<record> &batch) {
+            static char newline = '\n';
+            openLogFile();
+            std::vector<iovec> out, error, file;
+            for (const auto &entry: batch) {
+                const iovec line{const_cast<char *>(entry.text.data()), entry.text.size()};
+                auto &target = entry.level == severity::ERROR ? error : out;
+                target.push_back(line);
+                target.push_back({&newline, 1});
+                if (fileDescriptor >= 0) {
+                    file.push_back(line);
+                    file.push_back({&newline, 1});
+                }
+            }
+            writeAll(STDOUT_FILENO, out);
+            writeAll(STDERR_FILENO, error);
+            if (fileDescriptor >= 0) {
+                writeAll(fileDescriptor, file);
+                if (options.syncFile) {
+                    ::fdatasync(fileDescriptor);
+                }
+            }
+        }
+
+        // Follows setLogFile(); the file is opened for appending next to the config's stream.
+        void openLogFile() {
+            const auto current = getConfig()->getLogFile();
+            if (current == logFile) {
+                return;
+            }
+            logFile = current;
+            if (fileDescriptor >= 0) {
+                ::close(fileDescriptor);
+                fileDescriptor = -1;
+            }
+            if (current != nullptr && current->is_open()) {
+                current->flush();
+                fileDescriptor = ::open(getConfig()->getLogFilePath().c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+            }
+        }
+
+        static void writeAll(const int &descriptor, std::vector<iovec> &lines) {
+            size_t index = 0;
+            while (index < lines.size()) {
+                const int count = static_cast<int>(std::min<size_t>(lines.size() - index, IOV_MAX));
+                ssize_t written = ::writev(descriptor, &lines[index], count);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return;
+                }
+                while (index < lines.size() && static_cast<size_t>(written) >= lines[index].iov_len) {
+                    written -= static_cast<ssize_t>(lines[index].iov_len);
+                    ++index;
+                }
+                if (index < lines.size()) {
+                    lines[index].iov_base = static_cast<char *>(lines[index].iov_base) + written;
+                    lines[index].iov_len -= static_cast<size_t>(written);
+                }
+            }
+        }
+
+#else
+
+        void write(const std::vector<record> &batch) {
+            const auto logFile = getConfig()->getLogFile();
+            for (const auto &entry: batch) {
+                (entry.level == severity::ERROR ? std::cerr : std::cout) << entry.text << "\r\n";
+                if (logFile != nullptr && logFile->is_open()) {
+                    *logFile << entry.text << '\n';
+                }
+            }
+            std::cout.flush();
+            if (logFile != nullptr && logFile->is_open()) {
+                logFile->flush();
+            }
+        }
+
+#endif
+
+        asyncOptions options;
+        std::atomic_bool active = {false};
+        std::atomic_bool pending = {false};
+        std::atomic<uint64_t> dropped = {0};
+        bool stopping = false;
+        uint64_t flushRequests = 0;
+        uint64_t flushed = 0;
+        std::vector<std::shared_ptr<lineQueue>> queues;
+        std::shared_ptr<std::ofstream> logFile;
+        int fileDescriptor = -1;
+        std::thread writer;
+        std::mutex mutex;
+        std::mutex queuesMutex;
+        std::condition_variable condition;
+        std::condition_variable flushedCondition;
+    };
+
     struct LOGGER {
         std::stringstream buffer;
         severity level;
@@ -86,6 +420,10 @@ namespace logging {
         std::shared_ptr<std::ofstream> logFile;
 
         ~LOGGER() {
+            if (currentLogLevel <= level && asyncEnabled.load(std::memory_order_relaxed) &&
+                asyncWriter::getInstance().push(level, std::move(buffer).str())) {
+                return;
+            }
             std::lock_guard<std::mutex> lock(loggingMutex);
             if (currentLogLevel <= level) {
 #ifdef _WIN32
@@ -134,7 +472,24 @@ namespace logging {
         auto now = std::chrono::system_clock::now();
         auto in_time_t = std::chrono::system_clock::to_time_t(now);
         std::unique_ptr<LOGGER> logInst = logger(severity, logging::getConfig());
-        *logInst << std::put_time(std::localtime(&in_time_t), "%Y-%m-%d %X");
+        if (logInst->currentLogLevel > severity) {
+            return logInst;
+        }
+        // Formatted once per second and thread.
+        thread_local std::time_t formattedTime = -1;
+        thread_local std::string formatted;
+        if (in_time_t != formattedTime) {
+            std::tm local{};
+#ifdef _WIN32
+            localtime_s(&local, &in_time_t);
+#else
+            localtime_r(&in_time_t, &local);
+#endif
+            char text[64];
+            formatted.assign(text, std::strftime(text, sizeof(text), "%Y-%m-%d %X", &local));
+            formattedTime = in_time_t;
+        }
+        *logInst << formatted;
 
         switch (severity) {
             case TRACE: {
@@ -172,6 +527,29 @@ namespace logging {
     static inline void setLogFile(const std::string &logFile) {
         logging::getConfig()->setLogFile(logFile);
     };
+
+    // Hands finished lines to a background writer instead of writing them under loggingMutex.
+    static inline void enableAsync(const asyncOptions &options = {}) {
+        asyncWriter::getInstance().start(options);
+    };
+
+    static inline void disableAsync() {
+        if (asyncEnabled.load()) {
+            asyncWriter::getInstance().stop();
+        }
+    };
+
+    // Waits until everything logged so far is written; returns at once when async mode is off.
+    static inline void flush() {
+        if (asyncEnabled.load()) {
+            asyncWriter::getInstance().flush();
+        }
+    };
+
+    // Lines lost to a full queue with overflow::DROP.
+    static inline uint64_t getDroppedCount() {
+        return asyncWriter::getInstance().getDroppedCount();
+    };
 }  // namespace logging
 
 // ===== log macros =====
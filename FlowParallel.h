@@ -0,0 +1,268 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "WorkStealingPool.h"
+
+// Parallel algorithms over random-access ranges on a WorkStealingPool. Ranges are split in halves
+// recursively: the upper half is forked to the pool and the lower half is kept, so idle workers
+// steal large pieces and the owner works through small ones. Waiting threads run pool tasks
+// instead of blocking, so the algorithms may be nested and called from pool tasks.
+//
+// grain is the largest number of elements handled by one task; 0 picks one from the range size and
+// the pool size, never below minimumGrain. Pass a small grain when a single element is expensive.
+namespace FlowParallel {
+    static constexpr size_t minimumGrain = 1024;
+    static constexpr size_t chunksPerThread = 8;
+
+    // Counts forked tasks; the first exception thrown by one of them is rethrown by wait().
+    class TaskGroup {
+    public:
+        explicit TaskGroup(WorkStealingPool &pool) : pool(pool) {}
+
+        ~TaskGroup() {
+            help();
+        }
+
+        TaskGroup(const TaskGroup &) = delete;
+
+        TaskGroup &operator=(const TaskGroup &) = delete;
+
+        template<class Function>
+        void run(Function &&function) {
+            ++pending;
+            pool.addFunction(InlineTask([this, function = std::forward<Function>(function)]() mutable {
+                try {
+                    function();
+                } catch (...) {
+                    setError(std::current_exception());
+                }
+                --pending;
+            }));
+        }
+
+        void wait() {
+            help();
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        void help() {
+            while (pending.load(std::memory_order_acquire) != 0) {
+                if (!pool.runPendingTask()) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        void setError(std::exception_ptr exception) {
+            std::lock_guard<std::mutex> guard(errorMutex);
+            if (error == nullptr) {
+                error = std::move(exception);
+            }
+        }
+
+        WorkStealingPool &pool;
+        std::atomic_size_t pending = {0};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+    };
+
+    inline size_t grainFor(const WorkStealingPool &pool, const size_t &count, const size_t &grain) {
+        if (grain != 0) {
+            return grain;
+        }
+        const size_t chunks = pool.threadLimit * chunksPerThread;
+        return std::max(minimumGrain, (count + chunks - 1) / chunks);
+    }
+
+    template<class Body>
+    void split(TaskGroup &group, size_t begin, size_t end, const size_t &grain, Body &body) {
+        while (end - begin > grain) {
+            const size_t middle = begin + (end - begin) / 2;
+            group.run([&group, middle, end, grain, &body] {
+                split(group, middle, end, grain, body);
+            });
+            end = middle;
+        }
+        body(begin, end);
+    }
+
+    // Calls body(begin, end) for disjoint index ranges of at most grain elements covering [0, count).
+    template<class Body>
+    void forChunks(WorkStealingPool &pool, const size_t &count, const size_t &grain, Body body) {
+        if (count == 0) {
+            return;
+        }
+        if (count <= grain) {
+            body(0, count);
+            return;
+        }
+        TaskGroup group(pool);
+        split(group, 0, count, grain, body);
+        group.wait();
+    }
+
+    // Calls body(chunk, begin, end) for the fixed chunks [chunk * grain, (chunk + 1) * grain).
+    template<class Body>
+    void forEachChunk(WorkStealingPool &pool, const size_t &count, const size_t &grain, Body body) {
+        const size_t chunks = (count + grain - 1) / grain;
+        forChunks(pool, chunks, 1, [&](const size_t &first, const size_t &last) {
+            for (size_t chunk = first; chunk < last; ++chunk) {
+                body(chunk, chunk * grain, std::min(count, (chunk + 1) * grain));
+            }
+        });
+    }
+
+    template<class Iterator, class Function>
+    void for_each(WorkStealingPool &pool, Iterator first, Iterator last, Function function,
+                  const size_t &grain = 0) {
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        forChunks(pool, count, grainFor(pool, count, grain), [&](const size_t &begin, const size_t &end) {
+            std::for_each(first + begin, first + end, std::ref(function));
+        });
+    }
+
+    template<class InputIterator, class OutputIterator, class Function>
+    OutputIterator transform(WorkStealingPool &pool, InputIterator first, InputIterator last,
+                             OutputIterator output, Function function, const size_t &grain = 0) {
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        forChunks(pool, count, grainFor(pool, count, grain), [&](const size_t &begin, const size_t &end) {
+            std::transform(first + begin, first + end, output + begin, std::ref(function));
+        });
+        return output + count;
+    }
+
+    // operation must be associative; partial results are combined in range order, so it does not
+    // have to be commutative.
+    template<class Iterator, class T, class Operation = std::plus<>>
+    T reduce(WorkStealingPool &pool, Iterator first, Iterator last, T init, Operation operation = {},
+             const size_t &grain = 0) {
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        const size_t chunkSize = grainFor(pool, count, grain);
+        std::vector<std::optional<T>> partials((count + chunkSize - 1) / chunkSize);
+        forEachChunk(pool, count, chunkSize, [&](const size_t &chunk, const size_t &begin, const size_t &end) {
+            T value = first[begin];
+            for (size_t i = begin + 1; i < end; ++i) {
+                value = operation(std::move(value), first[i]);
+            }
+            partials[chunk].emplace(std::move(value));
+        });
+        for (auto &partial: partials) {
+            init = operation(std::move(init), std::move(*partial));
+        }
+        return init;
+    }
+
+    // Two passes: chunk totals in parallel, their running offsets serially, then every chunk scans
+    // again starting from its offset. output may equal first.
+    template<class InputIterator, class OutputIterator, class Operation = std::plus<>>
+    OutputIterator inclusive_scan(WorkStealingPool &pool, InputIterator first, InputIterator last,
+                                  OutputIterator output, Operation operation = {}, const size_t &grain = 0) {
+        using T = typename std::iterator_traits<InputIterator>::value_type;
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        const size_t chunkSize = grainFor(pool, count, grain);
+        const size_t chunks = (count + chunkSize - 1) / chunkSize;
+        std::vector<std::optional<T>> offsets(chunks);
+        if (chunks > 1) {
+            std::vector<std::optional<T>> totals(chunks);
+            forEachChunk(pool, count, chunkSize, [&](const size_t &chunk, const size_t &begin, const size_t &end) {
+                if (chunk + 1 == chunks) {
+                    return;
+                }
+                T value = first[begin];
+                for (size_t i = begin + 1; i < end; ++i) {
+                    value = operation(std::move(value), first[i]);
+                }
+                totals[chunk].emplace(std::move(value));
+            });
+            offsets[1] = std::move(totals[0]);
+            for (size_t chunk = 2; chunk < chunks; ++chunk) {
+                offsets[chunk].emplace(operation(*offsets[chunk - 1], std::move(*totals[chunk - 1])));
+            }
+        }
+        forEachChunk(pool, count, chunkSize, [&](const size_t &chunk, const size_t &begin, const size_t &end) {
+            T value = offsets[chunk] ? operation(*offsets[chunk], first[begin]) : T(first[begin]);
+            output[begin] = value;
+            for (size_t i = begin + 1; i < end; ++i) {
+                value = operation(std::move(value), first[i]);
+                output[i] = value;
+            }
+        });
+        return output + count;
+    }
+
+    template<class InputIterator, class OutputIterator, class T, class Operation = std::plus<>>
+    OutputIterator exclusive_scan(WorkStealingPool &pool, InputIterator first, InputIterator last,
+                                  OutputIterator output, T init, Operation operation = {},
+                                  const size_t &grain = 0) {
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        const size_t chunkSize = grainFor(pool, count, grain);
+        const size_t chunks = (count + chunkSize - 1) / chunkSize;
+        std::vector<std::optional<T>> totals(chunks);
+        if (chunks > 1) {
+            forEachChunk(pool, count, chunkSize, [&](const size_t &chunk, const size_t &begin, const size_t &end) {
+                if (chunk + 1 == chunks) {
+                    return;
+                }
+                T value = first[begin];
+                for (size_t i = begin + 1; i < end; ++i) {
+                    value = operation(std::move(value), first[i]);
+                }
+                totals[chunk].emplace(std::move(value));
+            });
+        }
+        std::vector<T> offsets;
+        offsets.reserve(chunks);
+        offsets.emplace_back(std::move(init));
+        for (size_t chunk = 1; chunk < chunks; ++chunk) {
+            offsets.emplace_back(operation(offsets.back(), std::move(*totals[chunk - 1])));
+        }
+        forEachChunk(pool, count, chunkSize, [&](const size_t &chunk, const size_t &begin, const size_t &end) {
+            T value = offsets[chunk];
+            for (size_t i = begin; i < end; ++i) {
+                T next = operation(value, first[i]);
+                output[i] = std::move(value);
+                value = std::move(next);
+            }
+        });
+        return output + count;
+    }
+
+    // Sorts fixed chunks in parallel, then merges neighbouring runs pairwise, each round in parallel.
+    // Not stable.
+    template<class Iterator, class Compare = std::less<>>
+    void sort(WorkStealingPool &pool, Iterator first, Iterator last, Compare compare = {},
+              const size_t &grain = 0) {
+        const auto count = static_cast<size_t>(std::distance(first, last));
+        const size_t chunkSize = grainFor(pool, count, grain);
+        const size_t chunks = (count + chunkSize - 1) / chunkSize;
+        forEachChunk(pool, count, chunkSize, [&](const size_t &, const size_t &begin, const size_t &end) {
+            std::sort(first + begin, first + end, compare);
+        });
+        const auto boundary = [&](const size_t &chunk) {
+            return first + std::min(count, chunk * chunkSize);
+        };
+        for (size_t width = 1; width < chunks; width *= 2) {
+            const size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+            forChunks(pool, pairs, 1, [&](const size_t &begin, const size_t &end) {
+                for (size_t pair = begin; pair < end; ++pair) {
+                    const size_t left = pair * 2 * width;
+                    if (left + width < chunks) {
+                        std::inplace_merge(boundary(left), boundary(left + width), boundary(left + 2 * width),
+                                           compare);
+                    }
+                }
+            });
+        }
+    }
+}
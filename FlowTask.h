@@ -0,0 +1,338 @@
+#pragma once
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "FlowLog.h"
+#include "InlineTask.h"
+
+template<class T = void>
+class FlowTask;
+
+namespace FlowCoroutine {
+    struct PromiseBase {
+        // Resumes whoever awaited the task by symmetric transfer, so chains of awaits do not nest.
+        struct FinalAwaiter {
+            bool await_ready() const noexcept {
+                return false;
+            }
+
+            template<class Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) const noexcept {
+                const auto continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {
+            }
+        };
+
+        std::suspend_always initial_suspend() const noexcept {
+            return {};
+        }
+
+        FinalAwaiter final_suspend() const noexcept {
+            return {};
+        }
+
+        void unhandled_exception() {
+            error = std::current_exception();
+        }
+
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+    };
+
+    template<class T>
+    struct Promise : PromiseBase {
+        FlowTask<T> get_return_object();
+
+        template<class U>
+        void return_value(U &&result) {
+            value.emplace(std::forward<U>(result));
+        }
+
+        T result() {
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+            return std::move(*value);
+        }
+
+        std::optional<T> value;
+    };
+
+    template<>
+    struct Promise<void> : PromiseBase {
+        FlowTask<void> get_return_object();
+
+        void return_void() const noexcept {
+        }
+
+        void result() const {
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+    // Eager coroutine that cleans up after itself; only used to drive FlowTasks from plain code.
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() const noexcept {
+                return {};
+            }
+
+            std::suspend_never initial_suspend() const noexcept {
+                return {};
+            }
+
+            std::suspend_never final_suspend() const noexcept {
+                return {};
+            }
+
+            void return_void() const noexcept {
+            }
+
+            void unhandled_exception() const noexcept {
+                std::terminate();
+            }
+        };
+    };
+
+    // Marks the await_suspend running on this thread. A task that runs or is dropped inside it, e.g.
+    // by CALLER_RUNS or a rejecting pool, lets await_suspend continue the coroutine by returning false
+    // rather than resuming it in a nested call from a frame that is still suspending.
+    class InlineSubmit {
+    public:
+        explicit InlineSubmit(std::coroutine_handle<> handle) : handle(handle),
+                                                                previous(std::exchange(current(), this)) {}
+
+        ~InlineSubmit() {
+            current() = previous;
+        }
+
+        InlineSubmit(const InlineSubmit &) = delete;
+
+        InlineSubmit &operator=(const InlineSubmit &) = delete;
+
+        bool completed() const {
+            return done;
+        }
+
+        // False unless handle belongs to the await_suspend running on this thread.
+        static bool complete(const std::coroutine_handle<> &handle) {
+            InlineSubmit *const submit = current();
+            if (submit == nullptr || submit->handle != handle) {
+                return false;
+            }
+            submit->done = true;
+            return true;
+        }
+
+    private:
+        static InlineSubmit *&current() {
+            static thread_local InlineSubmit *submit = nullptr;
+            return submit;
+        }
+
+        const std::coroutine_handle<> handle;
+        InlineSubmit *const previous;
+        bool done = false;
+    };
+
+    // Held by the task that resumes a coroutine on a pool. A pool that destroys the task without running
+    // it (rejected, DROP_OLDEST, stop(), cancelQueued(), an expired deadline) still resumes the
+    // coroutine, with an error its co_await throws, instead of leaking the suspended frame.
+    class PendingResume {
+    public:
+        PendingResume(std::coroutine_handle<> handle, std::exception_ptr *error) : handle(handle), error(error) {}
+
+        PendingResume(PendingResume &&other) noexcept : handle(std::exchange(other.handle, {})),
+                                                         error(other.error) {}
+
+        PendingResume &operator=(PendingResume &&) = delete;
+
+        ~PendingResume() {
+            if (handle) {
+                *error = std::make_exception_ptr(std::runtime_error("Pool dropped the coroutine"));
+                resume();
+            }
+        }
+
+        void resume() {
+            const auto toResume = std::exchange(handle, {});
+            if (!InlineSubmit::complete(toResume)) {
+                toResume.resume();
+            }
+        }
+
+    private:
+        std::coroutine_handle<> handle;
+        std::exception_ptr *error;
+    };
+
+    // co_await pool.schedule() continues the coroutine as a task of the pool; submit queues the task.
+    // The co_await throws when the pool rejects or sheds the task, see PendingResume.
+    template<class Submit>
+    class ScheduleAwaiter {
+    public:
+        explicit ScheduleAwaiter(Submit submit) : submit(std::move(submit)) {}
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            // The coroutine may resume and free this awaiter before submit returns, so it runs on a copy.
+            Submit toSubmit = submit;
+            const InlineSubmit inlineSubmit(handle);
+            toSubmit(InlineTask([resume = PendingResume(handle, &error)]() mutable {
+                resume.resume();
+            }));
+            return !inlineSubmit.completed();
+        }
+
+        void await_resume() const {
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        Submit submit;
+        std::exception_ptr error;
+    };
+}
+
+// Lazily started coroutine: nothing runs until the task is awaited (or handed to syncWait/spawn),
+// and the awaiting coroutine is resumed on whichever thread finishes the task.
+template<class T>
+class [[nodiscard]] FlowTask {
+public:
+    using promise_type = FlowCoroutine::Promise<T>;
+
+    FlowTask() = default;
+
+    FlowTask(FlowTask &&other) noexcept : handle(std::exchange(other.handle, {})) {}
+
+    FlowTask &operator=(FlowTask &&other) noexcept {
+        if (this != &other) {
+            if (handle) {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, {});
+        }
+        return *this;
+    }
+
+    FlowTask(const FlowTask &) = delete;
+
+    FlowTask &operator=(const FlowTask &) = delete;
+
+    ~FlowTask() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    bool valid() const {
+        return static_cast<bool>(handle);
+    }
+
+    bool done() const {
+        return handle && handle.done();
+    }
+
+    // An empty (default constructed or moved from) task has no coroutine to run or result to give.
+    bool await_ready() const {
+        if (!handle) {
+            throw std::logic_error("Awaiting an empty FlowTask");
+        }
+        return handle.done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        handle.promise().continuation = awaiting;
+        return handle;
+    }
+
+    T await_resume() {
+        return handle.promise().result();
+    }
+
+private:
+    friend promise_type;
+
+    explicit FlowTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+template<class T>
+FlowTask<T> FlowCoroutine::Promise<T>::get_return_object() {
+    return FlowTask<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+}
+
+inline FlowTask<void> FlowCoroutine::Promise<void>::get_return_object() {
+    return FlowTask<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+}
+
+namespace FlowCoroutine {
+    template<class T>
+    struct SyncState {
+        std::mutex mutex;
+        std::condition_variable condition;
+        bool done = false;
+        std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> value;
+        std::exception_ptr error;
+    };
+
+    template<class T>
+    Detached completeInto(FlowTask<T> task, SyncState<T> *state) {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await task;
+                state->value.emplace(true);
+            } else {
+                state->value.emplace(co_await task);
+            }
+        } catch (...) {
+            state->error = std::current_exception();
+        }
+        std::lock_guard<std::mutex> guard(state->mutex);
+        state->done = true;
+        state->condition.notify_all();
+    }
+
+    // Runs the task and blocks the calling thread until it finished; the bridge from plain code.
+    template<class T>
+    T syncWait(FlowTask<T> task) {
+        SyncState<T> state;
+        completeInto(std::move(task), &state);
+        std::unique_lock<std::mutex> lock(state.mutex);
+        state.condition.wait(lock, [&] {
+            return state.done;
+        });
+        if (state.error != nullptr) {
+            std::rethrow_exception(state.error);
+        }
+        if constexpr (!std::is_void_v<T>) {
+            return std::move(*state.value);
+        }
+    }
+
+    // Starts the task without waiting for it; an exception escaping it is logged.
+    inline Detached spawn(FlowTask<void> task) {
+        try {
+            co_await task;
+        } catch (const std::exception &e) {
+            LOG_WARNING << "Task failed: " << e.what();
+        }
+    }
+}
@@ -0,0 +1,284 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PoolMetrics.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+#include <x86intrin.h>
+
+#define FLOW_TRACE_HAS_TSC 1
+#endif
+
+// Scoped tracing for hot paths. A zone records its start and end timestamp (the TSC where there is
+// one, else steady_clock) into a buffer owned by its thread, a single producer ring that needs no lock
+// and no allocation; a full ring drops the zone and counts it. collect() drains all rings into
+// per-zone statistics and a bounded list of events, which summary() and writeChromeTrace() report;
+// the latter writes the Chrome trace event JSON that Perfetto and chrome://tracing open.
+//
+// FLOW_TRACE_ZONE("name") and FLOW_TRACE_FUNCTION() compile to nothing unless FLOW_TRACE is defined;
+// FlowTrace::setEnabled(false) turns recording off at run time. Zone names must outlive collect(),
+// string literals and __func__ do.
+namespace FlowTrace {
+    struct Event {
+        const char *name;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    // Durations in nanoseconds; percentiles within the histogram's ~6%.
+    struct ZoneStats {
+        std::string name;
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+    };
+
+    inline uint64_t now() {
+#ifdef FLOW_TRACE_HAS_TSC
+        return __rdtsc();
+#else
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    class ThreadBuffer {
+    public:
+        static constexpr size_t capacity = size_t(1) << 14;
+
+        explicit ThreadBuffer(const uint32_t &threadIndex) : threadIndex(threadIndex) {}
+
+        void push(const Event &event) {
+            const size_t position = head.load(std::memory_order_relaxed);
+            if (position - tail.load(std::memory_order_acquire) == capacity) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            events[position & (capacity - 1)] = event;
+            head.store(position + 1, std::memory_order_release);
+        }
+
+        // Only one thread at a time may drain.
+        template<class Consumer>
+        void drain(Consumer &&consumer) {
+            const size_t end = head.load(std::memory_order_acquire);
+            size_t position = tail.load(std::memory_order_relaxed);
+            for (; position != end; ++position) {
+                consumer(events[position & (capacity - 1)]);
+            }
+            tail.store(position, std::memory_order_release);
+        }
+
+        const uint32_t threadIndex;
+        std::atomic_bool retired = {false};
+        std::atomic<uint64_t> dropped = {0};
+
+    private:
+        std::unique_ptr<Event[]> events{new Event[capacity]};
+        alignas(64) std::atomic_size_t head = {0};
+        alignas(64) std::atomic_size_t tail = {0};
+    };
+
+    class Collector {
+    public:
+        static Collector &instance() {
+            static Collector collector;
+            return collector;
+        }
+
+        ThreadBuffer &local() {
+            struct Owner {
+                std::shared_ptr<ThreadBuffer> buffer;
+
+                ~Owner() {
+                    buffer->retired.store(true);
+                }
+            };
+            static thread_local Owner owner{instance().registerThread()};
+            return *owner.buffer;
+        }
+
+        // Drains every thread buffer; buffers of finished threads are dropped once empty.
+        void collect() {
+            std::lock_guard<std::mutex> guard(mutex);
+            for (auto iterator = buffers.begin(); iterator != buffers.end();) {
+                ThreadBuffer &buffer = **iterator;
+                const bool retired = buffer.retired.load();
+                buffer.drain([&](const Event &event) {
+                    record(buffer.threadIndex, event);
+                });
+                dropped += buffer.dropped.exchange(0, std::memory_order_relaxed);
+                iterator = retired ? buffers.erase(iterator) : iterator + 1;
+            }
+        }
+
+        std::vector<ZoneStats> summary() {
+            collect();
+            std::lock_guard<std::mutex> guard(mutex);
+            std::vector<ZoneStats> result;
+            for (const auto &[name, histogram]: zones) {
+                const auto snapshot = histogram->snapshot();
+                result.push_back({name, snapshot.count, snapshot.sum, snapshot.min, snapshot.max,
+                                  snapshot.percentile(50), snapshot.percentile(90), snapshot.percentile(99)});
+            }
+            return result;
+        }
+
+        void writeChromeTrace(std::ostream &out) {
+            collect();
+            std::lock_guard<std::mutex> guard(mutex);
+            const double scale = nanosecondsPerTick() / 1000.0;
+            out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            bool first = true;
+            for (const auto &[threadIndex, event]: retained) {
+                out << (first ? "" : ",") << "{\"name\":\"";
+                writeEscaped(out, event.name);
+                out << "\",\"cat\":\"flow\",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadIndex
+                    << ",\"ts\":" << static_cast<double>(event.start - origin) * scale
+                    << ",\"dur\":" << static_cast<double>(event.end - event.start) * scale << "}";
+                first = false;
+            }
+            out << "]}";
+        }
+
+        // Events kept for writeChromeTrace(); statistics keep counting past it.
+        void setRetainedLimit(const size_t &limit) {
+            std::lock_guard<std::mutex> guard(mutex);
+            retainedLimit = limit;
+        }
+
+        // Zones lost to a full thread buffer or past the retained limit.
+        uint64_t getDropped() {
+            collect();
+            std::lock_guard<std::mutex> guard(mutex);
+            return dropped;
+        }
+
+        void clear() {
+            collect();
+            std::lock_guard<std::mutex> guard(mutex);
+            zones.clear();
+            retained.clear();
+            dropped = 0;
+        }
+
+        std::atomic_bool enabled = {true};
+
+    private:
+        Collector() : origin(now()), originTime(std::chrono::steady_clock::now()) {}
+
+        std::shared_ptr<ThreadBuffer> registerThread() {
+            std::lock_guard<std::mutex> guard(mutex);
+            buffers.push_back(std::make_shared<ThreadBuffer>(nextThreadIndex++));
+            return buffers.back();
+        }
+
+        void record(const uint32_t &threadIndex, const Event &event) {
+            auto &histogram = zones[event.name];
+            if (!histogram) {
+                histogram = std::make_unique<LatencyHistogram>();
+            }
+            const uint64_t ticks = event.end > event.start ? event.end - event.start : 0;
+            histogram->record(static_cast<uint64_t>(static_cast<double>(ticks) * nanosecondsPerTick()));
+            if (retained.size() < retainedLimit) {
+                retained.emplace_back(threadIndex, event);
+            } else {
+                ++dropped;
+            }
+        }
+
+        // The TSC rate is measured against steady_clock over the collector's lifetime so far.
+        double nanosecondsPerTick() const {
+#ifdef FLOW_TRACE_HAS_TSC
+            const uint64_t ticks = now() - origin;
+            const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - originTime).count();
+            return ticks == 0 || elapsed <= 0 ? 1.0 : static_cast<double>(elapsed) / static_cast<double>(ticks);
+#else
+            return 1.0;
+#endif
+        }
+
+        static void writeEscaped(std::ostream &out, const std::string_view &text) {
+            for (const char character: text) {
+                if (character == '"' || character == '\\') {
+                    out << '\\' << character;
+                } else if (static_cast<unsigned char>(character) >= 0x20) {
+                    out << character;
+                }
+            }
+        }
+
+        const uint64_t origin;
+        const std::chrono::steady_clock::time_point originTime;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        std::map<std::string, std::unique_ptr<LatencyHistogram>, std::less<>> zones;
+        std::vector<std::pair<uint32_t, Event>> retained;
+        size_t retainedLimit = size_t(1) << 20;
+        uint64_t dropped = 0;
+        uint32_t nextThreadIndex = 1;
+        std::mutex mutex;
+    };
+
+    class Zone {
+    public:
+        explicit Zone(const char *name) : name(Collector::instance().enabled.load(std::memory_order_relaxed)
+                                               ? name : nullptr), start(this->name ? now() : 0) {}
+
+        ~Zone() {
+            if (name != nullptr) {
+                Collector::instance().local().push({name, start, now()});
+            }
+        }
+
+        Zone(const Zone &) = delete;
+
+        Zone &operator=(const Zone &) = delete;
+
+    private:
+        const char *const name;
+        const uint64_t start;
+    };
+
+    inline void setEnabled(const bool &enabled) {
+        Collector::instance().enabled.store(enabled);
+    }
+
+    inline void collect() {
+        Collector::instance().collect();
+    }
+
+    inline std::vector<ZoneStats> summary() {
+        return Collector::instance().summary();
+    }
+
+    inline void writeChromeTrace(std::ostream &out) {
+        Collector::instance().writeChromeTrace(out);
+    }
+}
+
+#define FLOW_TRACE_CONCAT_(a, b) a##b
+#define FLOW_TRACE_CONCAT(a, b) FLOW_TRACE_CONCAT_(a, b)
+
+#ifdef FLOW_TRACE
+#define FLOW_TRACE_ZONE(name) const FlowTrace::Zone FLOW_TRACE_CONCAT(flowTraceZone, __LINE__)(name)
+#define FLOW_TRACE_FUNCTION() FLOW_TRACE_ZONE(__func__)
+#else
+#define FLOW_TRACE_ZONE(name) static_cast<void>(0)
+#define FLOW_TRACE_FUNCTION() static_cast<void>(0)
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+// Thin wrappers around the Linux futex syscall on a 32 bit atomic word. FLOW_HAS_FUTEX is only defined
+// where the syscall exists so callers can fall back to a mutex and condition variable elsewhere.
+#ifdef __linux__
+#define FLOW_HAS_FUTEX 1
+
+namespace FlowFutex {
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex word must be 32 bit");
+
+    inline void wait(std::atomic<uint32_t> &word, const uint32_t expected) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    // Returns false once the timeout expired, true on a wake up, a spurious wake up or a changed word.
+    inline bool waitFor(std::atomic<uint32_t> &word, const uint32_t expected, const std::chrono::nanoseconds &timeout) {
+        if (timeout <= std::chrono::nanoseconds::zero()) {
+            return false;
+        }
+        const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+        timespec time{};
+        time.tv_sec = static_cast<time_t>(seconds.count());
+        time.tv_nsec = static_cast<long>((timeout - seconds).count());
+        const auto result = syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected,
+                                    &time, nullptr, 0);
+        return !(result == -1 && errno == ETIMEDOUT);
+    }
+
+    inline void wake(std::atomic<uint32_t> &word, const int count = 1) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+
+    inline void wakeAll(std::atomic<uint32_t> &word) {
+        wake(word, INT_MAX);
+    }
+}
+
+#endif
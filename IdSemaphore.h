@@ -1,57 +1,42 @@
 #pragma once
 
-#include <mutex>
-#include <condition_variable>
-#include <atomic>
-#include <unordered_map>
-#include "Semaphore.h"
+#include <string>
+#include <string_view>
+#include "KeyedLockManager.h"
 
+// Per id mutual exclusion without guards, for callers that lock and unlock in different scopes.
+// Use KeyedLockManager directly for RAII guards, try-locks and timeouts.
 class IdSemaphore {
 public:
-    void addLock(const std::string &id) {
-        mainLock.lock();
-        if (semaphreMap.contains(id)) {
+    explicit IdSemaphore(const size_t &shardCount = 64) : locks(shardCount) {}
 
+    // Takes the id's lock if it is free, without waiting; returns whether it did.
+    bool addLock(std::string_view id) {
+        auto guard = locks.tryLock(id);
+        if (!guard) {
+            return false;
         }
-        mainLock.unlock();
+        guard.release();
+        return true;
     }
 
-    void lock(const std::string &id) {
-        if (semaphreMap.contains(id)) {
-            semaphreMap.at(id).lock();
-        } else {
-            mainLock.lock();
-            semaphreMap[id].lock();
-            mainLock.unlock();
-        }
+    void lock(std::string_view id) {
+        locks.lock(id).release();
     }
 
-    void wait(const std::string &id) {
-        if (semaphreMap.contains(id)) {
-            mainLock.wait();
-        }
+    // Blocks until nobody holds the id's lock.
+    void wait(std::string_view id) {
+        auto guard = locks.lock(id);
     }
 
-    void unlock(const std::string &id) {
-        mainLock.lock();
-        if (semaphreMap.contains(id)) {
-            semaphreMap.at(id).unlock();
-            semaphreMap.erase(id);
-        }
-        mainLock.unlock();
+    void unlock(std::string_view id) {
+        locks.unlock(id);
     }
 
-//    void unlock_one(const std::string &id) {
-//        mainLock.lock();
-//        if (semaphreMap.contains(id)) {
-//
-//        }
-//        mainLock.unlock();
-//    }
+    bool isLocked(std::string_view id) const {
+        return locks.isLocked(id);
+    }
 
 private:
-    Semaphore mainLock;
-    std::unordered_map<std::string, Semaphore> semaphreMap;
-    std::condition_variable condition_;
-    std::atomic_size_t lockCount = 0;
-};
\ No newline at end of file
+    KeyedLockManager locks;
+};
@@ -4,8 +4,11 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <coroutine>
+#include <unordered_map>
 #include "IdleObject.h"
-#include <FlowUtils/Semaphore.h>
 //#include <FlowUtils/LifetimeClock.h>
 
 
@@ -14,25 +17,64 @@ class IdleManager {
 public:
     void add(std::shared_ptr<IdleType> object) {
         objectMap[idCounter] = object;
-        idleQueue.emplace(idCounter);
+        toIdle(idCounter);
         idCounter++;
     }
     std::unique_ptr<IdleObject<IdleType>> get() {
 //        LifetimeClock_Seconds lifetimeClock;
-        std::lock_guard<std::mutex> lg(getMutex);
-        emptySemaphore.wait();
-        idleMutex.lock();
-        const auto item = idleQueue.front();
-        idleQueue.pop();
-        idleMutex.unlock();
-        if(idleQueue.empty())
-            emptySemaphore.addLock();
-        const auto mapitem = objectMap.at(item);
+        size_t item;
+        {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idleAvailable.wait(lock, [this] {
+                return !idleQueue.empty();
+            });
+            item = idleQueue.front();
+            idleQueue.pop();
+        }
+        return checkout(item);
+    }
 
-        return std::make_unique<IdleObject<IdleType>>(item, mapitem, [&](const size_t id){
-            std::lock_guard<std::mutex> lg(idleMutex);
-            toIdle(id);
-        });
+    // auto object = co_await manager.getAsync(); checks an object out like get() but suspends the
+    // coroutine instead of blocking its thread while none is idle. It is resumed on the thread that
+    // returns an object.
+    auto getAsync() {
+        class Awaiter {
+        public:
+            explicit Awaiter(IdleManager &manager) : manager(manager) {}
+
+            bool await_ready() {
+                std::lock_guard<std::mutex> lg(manager.idleMutex);
+                if (manager.idleQueue.empty()) {
+                    return false;
+                }
+                item = manager.idleQueue.front();
+                manager.idleQueue.pop();
+                return true;
+            }
+
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lg(manager.idleMutex);
+                if (!manager.idleQueue.empty()) {
+                    item = manager.idleQueue.front();
+                    manager.idleQueue.pop();
+                    return false;
+                }
+                waiting.handle = handle;
+                waiting.item = &item;
+                manager.asyncWaiters.push(&waiting);
+                return true;
+            }
+
+            std::unique_ptr<IdleObject<IdleType>> await_resume() {
+                return manager.checkout(item);
+            }
+
+        private:
+            IdleManager &manager;
+            size_t item = 0;
+            AsyncWaiter waiting;
+        };
+        return Awaiter(*this);
     }
 
     std::vector<std::shared_ptr<IdleType>> releaseAll() {
@@ -45,16 +87,42 @@ public:
     }
 
 private:
+    struct AsyncWaiter {
+        std::coroutine_handle<> handle;
+        size_t *item = nullptr;
+    };
+
+    std::unique_ptr<IdleObject<IdleType>> checkout(const size_t &item) {
+        const auto mapitem = objectMap.at(item);
+        return std::make_unique<IdleObject<IdleType>>(item, mapitem, [this](const size_t id) {
+            toIdle(id);
+        });
+    }
+
+    // A returned object goes straight to the oldest suspended getAsync, otherwise back to the queue.
     void toIdle(const size_t id){
-        idleQueue.emplace(id);
-        emptySemaphore.unlock();
+        std::coroutine_handle<> toResume;
+        {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            if (asyncWaiters.empty()) {
+                idleQueue.emplace(id);
+                lock.unlock();
+                idleAvailable.notify_one();
+                return;
+            }
+            AsyncWaiter *waiter = asyncWaiters.front();
+            asyncWaiters.pop();
+            *waiter->item = id;
+            toResume = waiter->handle;
+        }
+        toResume.resume();
     }
     size_t idCounter = 0;
     std::unordered_map<size_t, std::shared_ptr<IdleType>> objectMap;
 //    std::queue<size_t> idleQueue;
     std::queue<size_t> idleQueue;
-    std::mutex getMutex;
     std::mutex idleMutex;
-    Semaphore emptySemaphore;
+    std::condition_variable idleAvailable;
+    std::queue<AsyncWaiter *> asyncWaiters;
     int gone = 0;
 };
\ No newline at end of file
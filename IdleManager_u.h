@@ -4,6 +4,8 @@
 #include <vector>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
 #include "IdleObject_u.h"
 #include <FlowUtils/Semaphore.h>
 
@@ -12,19 +14,29 @@ template<class IdleType>
 class IdleManager_u {
 public:
     void add(IdleType object) {
-        objectMap[idCounter] = object;
-        idleQueue.emplace(idCounter);
+        objectMap[idCounter] = std::move(object);
+        toIdle(idCounter);
         idCounter++;
     }
+    // The handle refers to the stored object itself; map nodes stay put, so no copy is needed.
     std::unique_ptr<IdleObject_u<IdleType>> get() {
         std::lock_guard<std::mutex> lg(getMutex);
-        emptySemaphore.wait();
-        const auto item = idleQueue.front();
-        idleQueue.pop();
-        if(!idleQueue.empty())
-            emptySemaphore.addLock();
-        auto mapitem = objectMap.at(item);
-        return std::make_unique<IdleObject_u<IdleType>>(item, mapitem, [&](const size_t id){
+        size_t item;
+        while (true) {
+            emptySemaphore.wait();
+            std::lock_guard<std::mutex> idleGuard(idleMutex);
+            if (idleQueue.empty()) {
+                emptySemaphore.addLock();
+                continue;
+            }
+            item = idleQueue.front();
+            idleQueue.pop();
+            if (idleQueue.empty())
+                emptySemaphore.addLock();
+            break;
+        }
+        auto &mapitem = objectMap.at(item);
+        return std::make_unique<IdleObject_u<IdleType>>(item, mapitem, [this](const size_t id){
             toIdle(id);
         });
     }
@@ -40,13 +52,15 @@ public:
 
 private:
     void toIdle(const size_t id){
+        std::lock_guard<std::mutex> lg(idleMutex);
         idleQueue.emplace(id);
         emptySemaphore.unlock_one();
     }
-    size_t idCounter;
+    size_t idCounter = 0;
     std::unordered_map<size_t, IdleType> objectMap;
     std::queue<size_t> idleQueue;
     std::mutex getMutex;
+    std::mutex idleMutex;
     Semaphore emptySemaphore;
     int gone = 0;
 };
\ No newline at end of file
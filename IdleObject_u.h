@@ -8,10 +8,9 @@ class IdleObject_u {
 public:
     IdleObject_u(const size_t &id,
                IdleType& object,
-               const std::function<void(size_t)> &cb) : id(id),
-//                                                        object(object),
+               const std::function<void(size_t)> &cb) : object(&object),
+                                                        id(id),
                                                         finishedCb(cb) {
-        object = object;
     }
 
     ~IdleObject_u() {
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Move-only callable wrapper with small-buffer storage. Callables up to Capacity bytes that are
+// nothrow-movable live inside the object, so submitting a typical lambda costs no allocation and no
+// reference counting. Larger callables fall back to a single owned heap allocation.
+template<class Signature, size_t Capacity = 56>
+class InlineFunction;
+
+template<class Result, class... Args, size_t Capacity>
+class InlineFunction<Result(Args...), Capacity> {
+public:
+    InlineFunction() noexcept = default;
+
+    InlineFunction(std::nullptr_t) noexcept {}
+
+    template<class Function, class = std::enable_if_t<
+            !std::is_same_v<std::decay_t<Function>, InlineFunction> &&
+            std::is_invocable_r_v<Result, std::decay_t<Function> &, Args...>>>
+    InlineFunction(Function &&function) {
+        using Stored = std::decay_t<Function>;
+        if constexpr (storedInline<Stored>()) {
+            new(&storage) Stored(std::forward<Function>(function));
+            operations = &inlineOperations<Stored>;
+        } else {
+            new(&storage) Stored *(new Stored(std::forward<Function>(function)));
+            operations = &heapOperations<Stored>;
+        }
+    }
+
+    InlineFunction(InlineFunction &&other) noexcept {
+        moveFrom(other);
+    }
+
+    InlineFunction &operator=(InlineFunction &&other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    InlineFunction &operator=(std::nullptr_t) noexcept {
+        reset();
+        return *this;
+    }
+
+    InlineFunction(const InlineFunction &) = delete;
+
+    InlineFunction &operator=(const InlineFunction &) = delete;
+
+    ~InlineFunction() {
+        reset();
+    }
+
+    Result operator()(Args... args) {
+        return operations->invoke(&storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const noexcept {
+        return operations != nullptr;
+    }
+
+    template<class Function>
+    static constexpr bool storedInline() {
+        return sizeof(Function) <= Capacity && alignof(Function) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<Function>;
+    }
+
+private:
+    struct Operations {
+        Result (*invoke)(void *storage, Args &&... args);
+
+        void (*move)(void *from, void *to) noexcept;
+
+        void (*destroy)(void *storage) noexcept;
+    };
+
+    template<class Function>
+    static Result call(Function &function, Args &&... args) {
+        if constexpr (std::is_void_v<Result>) {
+            function(std::forward<Args>(args)...);
+        } else {
+            return function(std::forward<Args>(args)...);
+        }
+    }
+
+    template<class Function>
+    static inline constexpr Operations inlineOperations = {
+            [](void *storage, Args &&... args) -> Result {
+                return call(*static_cast<Function *>(storage), std::forward<Args>(args)...);
+            },
+            [](void *from, void *to) noexcept {
+                new(to) Function(std::move(*static_cast<Function *>(from)));
+                static_cast<Function *>(from)->~Function();
+            },
+            [](void *storage) noexcept {
+                static_cast<Function *>(storage)->~Function();
+            }
+    };
+
+    template<class Function>
+    static inline constexpr Operations heapOperations = {
+            [](void *storage, Args &&... args) -> Result {
+                return call(**static_cast<Function **>(storage), std::forward<Args>(args)...);
+            },
+            [](void *from, void *to) noexcept {
+                new(to) Function *(*static_cast<Function **>(from));
+            },
+            [](void *storage) noexcept {
+                delete *static_cast<Function **>(storage);
+            }
+    };
+
+    void moveFrom(InlineFunction &other) noexcept {
+        if (other.operations != nullptr) {
+            other.operations->move(&other.storage, &storage);
+            operations = other.operations;
+            other.operations = nullptr;
+        }
+    }
+
+    void reset() noexcept {
+        if (operations != nullptr) {
+            operations->destroy(&storage);
+            operations = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage[Capacity];
+    const Operations *operations = nullptr;
+};
+
+using InlineTask = InlineFunction<void()>;
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Mutual exclusion per string key. Keys hash onto a fixed number of shards, each a mutex and a map of
+// the keys currently locked or waited for. An entry counts its holder and waiters and is erased when
+// the last of them leaves, so memory follows the contended keys rather than every key ever seen.
+// Lookups take a std::string_view; a std::string is only built when a key gets its first entry.
+class KeyedLockManager {
+    struct Entry;
+    struct Shard;
+
+public:
+    // Owns the lock of one key until destroyed, unlock()ed or release()d; empty after a failed try.
+    class Guard {
+    public:
+        Guard() = default;
+
+        Guard(Guard &&other) noexcept
+                : manager(std::exchange(other.manager, nullptr)), shard(other.shard), key(other.key) {}
+
+        Guard &operator=(Guard &&other) noexcept {
+            if (this != &other) {
+                unlock();
+                manager = std::exchange(other.manager, nullptr);
+                shard = other.shard;
+                key = other.key;
+            }
+            return *this;
+        }
+
+        Guard(const Guard &) = delete;
+
+        Guard &operator=(const Guard &) = delete;
+
+        ~Guard() {
+            unlock();
+        }
+
+        bool ownsLock() const {
+            return manager != nullptr;
+        }
+
+        explicit operator bool() const {
+            return ownsLock();
+        }
+
+        void unlock() {
+            if (manager != nullptr) {
+                std::exchange(manager, nullptr)->release(*shard, *key);
+            }
+        }
+
+        // Leaves the key locked without owning it; KeyedLockManager::unlock(key) releases it later.
+        void release() {
+            manager = nullptr;
+        }
+
+    private:
+        friend class KeyedLockManager;
+
+        Guard(KeyedLockManager *manager, Shard *shard, const std::string *key)
+                : manager(manager), shard(shard), key(key) {}
+
+        KeyedLockManager *manager = nullptr;
+        Shard *shard = nullptr;
+        // Points into the shard's map, whose nodes stay put while the entry is referenced.
+        const std::string *key = nullptr;
+    };
+
+    explicit KeyedLockManager(const size_t &shardCount = 64) : shards(shardCount == 0 ? 1 : shardCount) {}
+
+    KeyedLockManager(const KeyedLockManager &) = delete;
+
+    KeyedLockManager &operator=(const KeyedLockManager &) = delete;
+
+    [[nodiscard]] Guard lock(std::string_view key) {
+        return acquire(key, false, {});
+    }
+
+    // Never waits: the guard is empty when another thread holds the key.
+    [[nodiscard]] Guard tryLock(std::string_view key) {
+        return acquire(key, true, std::chrono::steady_clock::now());
+    }
+
+    template<class Rep, class Period>
+    [[nodiscard]] Guard tryLockFor(std::string_view key, const std::chrono::duration<Rep, Period> &timeout) {
+        return acquire(key, true, std::chrono::steady_clock::now() +
+                                  std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    }
+
+    // Releases a key whose guard was release()d; does nothing when the key is not locked.
+    void unlock(std::string_view key) {
+        release(shardFor(Hash{}(key)), key);
+    }
+
+    bool isLocked(std::string_view key) const {
+        const Shard &shard = shardFor(Hash{}(key));
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        const auto it = shard.entries.find(key);
+        return it != shard.entries.end() && it->second.locked;
+    }
+
+    // Keys currently locked or waited for.
+    size_t size() const {
+        size_t total = 0;
+        for (const auto &shard: shards) {
+            std::lock_guard<std::mutex> guard(shard.mutex);
+            total += shard.entries.size();
+        }
+        return total;
+    }
+
+private:
+    struct Hash {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view key) const {
+            return std::hash<std::string_view>{}(key);
+        }
+    };
+
+    struct Entry {
+        size_t references = 0;
+        bool locked = false;
+        std::condition_variable released;
+    };
+
+    struct alignas(64) Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry, Hash, std::equal_to<>> entries;
+    };
+
+    Shard &shardFor(const size_t &hash) {
+        return shards[hash % shards.size()];
+    }
+
+    const Shard &shardFor(const size_t &hash) const {
+        return shards[hash % shards.size()];
+    }
+
+    Guard acquire(std::string_view key, const bool &timed, const std::chrono::steady_clock::time_point &deadline) {
+        Shard &shard = shardFor(Hash{}(key));
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(key);
+        if (it == shard.entries.end()) {
+            it = shard.entries.try_emplace(std::string(key)).first;
+        }
+        Entry &entry = it->second;
+        ++entry.references;
+        while (entry.locked) {
+            if (!timed) {
+                entry.released.wait(lock);
+            } else if (entry.released.wait_until(lock, deadline) == std::cv_status::timeout && entry.locked) {
+                if (--entry.references == 0) {
+                    shard.entries.erase(shard.entries.find(key));
+                }
+                return {};
+            }
+        }
+        entry.locked = true;
+        return {this, &shard, &it->first};
+    }
+
+    void release(Shard &shard, std::string_view key) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        const auto it = shard.entries.find(key);
+        if (it == shard.entries.end() || !it->second.locked) {
+            return;
+        }
+        Entry &entry = it->second;
+        entry.locked = false;
+        if (--entry.references != 0) {
+            entry.released.notify_one();
+            return;
+        }
+        shard.entries.erase(it);
+    }
+
+    std::vector<Shard> shards;
+};
@@ -21,7 +21,7 @@ public:
     }
 
     void PrintTimeRunning() const {
-        const auto end = std::chrono::system_clock::now();
+        const auto end = std::chrono::steady_clock::now();
         const auto elapsedTime = std::chrono::duration_cast<T>
                 (end - start).count();
 
@@ -29,7 +29,7 @@ public:
     }
 
     auto GetElapsedTime() const {
-        const auto end = std::chrono::system_clock::now();
+        const auto end = std::chrono::steady_clock::now();
         return std::chrono::duration_cast<T>
                 (end - start).count();
     }
@@ -39,7 +39,7 @@ public:
     std::string Suffix = "\n";
     bool DoNotPrint;
 private:
-    std::chrono::time_point <std::chrono::system_clock> start = std::chrono::system_clock::now();
+    std::chrono::time_point <std::chrono::steady_clock> start = std::chrono::steady_clock::now();
 
 };
 
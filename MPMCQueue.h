@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Bounded lock-free multi-producer/multi-consumer ring (Vyukov). Each cell carries a sequence number
+// so producers and consumers only contend on their own position counter. The blocking and timed
+// variants spin briefly and then park on a condition variable that is only touched while someone waits.
+template<class T>
+class MPMCQueue {
+public:
+    explicit MPMCQueue(const size_t &capacity = 1024) : mask(roundUp(capacity) - 1),
+                                                        cells(new Cell[mask + 1]) {
+        for (size_t i = 0; i <= mask; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MPMCQueue(const MPMCQueue &) = delete;
+
+    MPMCQueue &operator=(const MPMCQueue &) = delete;
+
+    template<class U>
+    bool tryPush(U &&value) {
+        Cell *cell;
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<U>(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        notify(popWaiters, notEmpty);
+        return true;
+    }
+
+    bool tryPop(T &value) {
+        Cell *cell;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        while (true) {
+            cell = &cells[pos & mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        notify(pushWaiters, notFull);
+        return true;
+    }
+
+    template<class U>
+    void push(U &&value) {
+        waitFor(pushWaiters, notFull, [&] { return tryPush(std::forward<U>(value)); },
+                [&] { return size() < capacity(); }, std::chrono::steady_clock::time_point::max());
+    }
+
+    void pop(T &value) {
+        waitFor(popWaiters, notEmpty, [&] { return tryPop(value); },
+                [&] { return !empty(); }, std::chrono::steady_clock::time_point::max());
+    }
+
+    template<class U, class Rep, class Period>
+    bool pushFor(U &&value, const std::chrono::duration<Rep, Period> &timeout) {
+        return waitFor(pushWaiters, notFull, [&] { return tryPush(std::forward<U>(value)); },
+                       [&] { return size() < capacity(); }, std::chrono::steady_clock::now() + timeout);
+    }
+
+    template<class Rep, class Period>
+    bool popFor(T &value, const std::chrono::duration<Rep, Period> &timeout) {
+        return waitFor(popWaiters, notEmpty, [&] { return tryPop(value); },
+                       [&] { return !empty(); }, std::chrono::steady_clock::now() + timeout);
+    }
+
+    // Approximate while other threads are pushing or popping.
+    size_t size() const {
+        const size_t enqueued = enqueuePos.load(std::memory_order_acquire);
+        const size_t dequeued = dequeuePos.load(std::memory_order_acquire);
+        return enqueued > dequeued ? enqueued - dequeued : 0;
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+private:
+    struct Cell {
+        std::atomic_size_t sequence;
+        T data;
+    };
+
+    static size_t roundUp(size_t capacity) {
+        size_t rounded = 2;
+        while (rounded < capacity) {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    void notify(const std::atomic_size_t &waiters, std::condition_variable &condition) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiters > 0) {
+            std::lock_guard<std::mutex> guard(waitMutex);
+            condition.notify_one();
+        }
+    }
+
+    template<class Attempt, class Ready>
+    bool waitFor(std::atomic_size_t &waiters, std::condition_variable &condition, Attempt attempt, Ready ready,
+                 const std::chrono::steady_clock::time_point &deadline) {
+        for (size_t spin = 0; spin < spinCount; ++spin) {
+            if (attempt()) {
+                return true;
+            }
+            std::this_thread::yield();
+        }
+        while (!attempt()) {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            ++waiters;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool timedOut = false;
+            if (!ready()) {
+                if (deadline == std::chrono::steady_clock::time_point::max()) {
+                    condition.wait(lock);
+                } else {
+                    timedOut = condition.wait_until(lock, deadline) == std::cv_status::timeout;
+                }
+            }
+            --waiters;
+            if (timedOut) {
+                lock.unlock();
+                return attempt();
+            }
+        }
+        return true;
+    }
+
+    static constexpr size_t spinCount = 64;
+
+    const size_t mask;
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic_size_t enqueuePos = {0};
+    alignas(64) std::atomic_size_t dequeuePos = {0};
+    alignas(64) std::atomic_size_t pushWaiters = {0};
+    std::atomic_size_t popWaiters = {0};
+    std::mutex waitMutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
@@ -3,6 +3,7 @@
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include "AsyncWaiters.h"
 
 class MultiSemaphore {
 public:
@@ -22,12 +23,27 @@ public:
         }
     }
 
+    // co_await lockAsync()/waitAsync() behave like lock()/wait() but suspend the coroutine instead of
+    // blocking its thread. It is resumed on the thread that unlocks.
+    SemaphoreAwaiter<MultiSemaphore> lockAsync() {
+        return {*this, true};
+    }
+
+    SemaphoreAwaiter<MultiSemaphore> waitAsync() {
+        return {*this, false};
+    }
+
     void unlock() {
-        std::lock_guard<std::mutex> lg(mutex_);
-        if (lockCount != 0)
-            --lockCount;
-        if (lockCount == 0)
-            condition_.notify_all();
+        std::vector<std::coroutine_handle<>> toResume;
+        {
+            std::lock_guard<std::mutex> lg(mutex_);
+            if (lockCount != 0)
+                --lockCount;
+            if (lockCount == 0)
+                condition_.notify_all();
+            waiters.collect(lockCount, toResume);
+        }
+        AsyncWaiters::resume(toResume);
     }
 
     void addLock() {
@@ -39,7 +55,23 @@ public:
     }
 
 private:
+    friend class SemaphoreAwaiter<MultiSemaphore>;
+
+    bool suspend(std::coroutine_handle<> handle, const bool &isLock) {
+        std::lock_guard<std::mutex> lg(mutex_);
+        if (isLock) {
+            ++lockCount;
+        }
+        const size_t limit = isLock ? 1 : 0;
+        if (lockCount <= limit) {
+            return false;
+        }
+        waiters.add(handle, limit);
+        return true;
+    }
+
     std::mutex mutex_;
     std::condition_variable condition_;
     std::atomic_size_t lockCount = 0;
+    AsyncWaiters waiters;
 };
\ No newline at end of file
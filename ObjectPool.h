@@ -0,0 +1,249 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <optional>
+#include <thread>
+#include <utility>
+#include "Futex.h"
+
+// Fixed set of objects checked out through move-only handles. Objects live in one array and are found
+// through a lock-free stack of indices with a tagged head, so checkout neither locks nor allocates.
+// Every thread also releases into and acquires from a one object cache slot (hardware_concurrency()
+// of them, picked per thread), which keeps a recently used, cache-warm object with its thread and off
+// the shared stack. acquire() sleeps on a futex while everything is checked out; the pool must
+// outlive its handles.
+template<class T>
+class ObjectPool {
+public:
+    class Handle {
+    public:
+        Handle() = default;
+
+        Handle(Handle &&other) noexcept : pool(std::exchange(other.pool, nullptr)), index(other.index) {}
+
+        Handle &operator=(Handle &&other) noexcept {
+            if (this != &other) {
+                reset();
+                pool = std::exchange(other.pool, nullptr);
+                index = other.index;
+            }
+            return *this;
+        }
+
+        Handle(const Handle &) = delete;
+
+        Handle &operator=(const Handle &) = delete;
+
+        ~Handle() {
+            reset();
+        }
+
+        explicit operator bool() const {
+            return pool != nullptr;
+        }
+
+        T &operator*() const {
+            return *get();
+        }
+
+        T *operator->() const {
+            return get();
+        }
+
+        T *get() const {
+            return pool == nullptr ? nullptr : &*pool->objects[index];
+        }
+
+        // Returns the object to the pool early.
+        void reset() {
+            if (pool != nullptr) {
+                std::exchange(pool, nullptr)->release(index);
+            }
+        }
+
+    private:
+        friend class ObjectPool;
+
+        Handle(ObjectPool *pool, const uint32_t &index) : pool(pool), index(index) {}
+
+        ObjectPool *pool = nullptr;
+        uint32_t index = 0;
+    };
+
+    // Builds count objects with factory(), which returns a T. The result is built in place, so T
+    // need not be movable.
+    template<class Factory>
+    ObjectPool(const size_t &count, Factory factory)
+            : capacity(static_cast<uint32_t>(count)), objects(std::make_unique<std::optional<T>[]>(count)),
+              next(std::make_unique<std::atomic<uint32_t>[]>(count)),
+              cacheCount(std::max(1u, std::thread::hardware_concurrency())),
+              caches(std::make_unique<Cache[]>(cacheCount)) {
+        for (uint32_t i = capacity; i-- > 0;) {
+            objects[i].emplace(Built<Factory>{factory});
+            push(i);
+        }
+    }
+
+    explicit ObjectPool(const size_t &count) : ObjectPool(count, [] {
+        return T();
+    }) {}
+
+    ObjectPool(const ObjectPool &) = delete;
+
+    ObjectPool &operator=(const ObjectPool &) = delete;
+
+    // An empty handle when every object is checked out.
+    [[nodiscard]] Handle tryAcquire() {
+        uint32_t index = caches[cacheIndex()].index.exchange(NONE);
+        if (index == NONE && !pop(index) && !stealCached(index)) {
+            return {};
+        }
+        return {this, index};
+    }
+
+    [[nodiscard]] Handle acquire() {
+        return acquireUntil(std::chrono::steady_clock::time_point::max());
+    }
+
+    template<class Rep, class Period>
+    [[nodiscard]] Handle tryAcquireFor(const std::chrono::duration<Rep, Period> &timeout) {
+        return acquireUntil(std::chrono::steady_clock::now() +
+                            std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    }
+
+    size_t size() const {
+        return capacity;
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // Converts to the factory's result, which then initialises the stored T directly.
+    template<class Factory>
+    struct Built {
+        Factory &factory;
+
+        operator T() const {
+            return factory();
+        }
+    };
+
+    struct alignas(64) Cache {
+        std::atomic<uint32_t> index = {NONE};
+    };
+
+    size_t cacheIndex() const {
+        static std::atomic_size_t threadCount = {0};
+        static thread_local const size_t threadIndex = threadCount++;
+        return threadIndex % cacheCount;
+    }
+
+    Handle acquireUntil(const std::chrono::steady_clock::time_point &deadline) {
+        const bool infinite = deadline == std::chrono::steady_clock::time_point::max();
+        while (true) {
+            const uint32_t seen = releases.load();
+            if (auto handle = tryAcquire()) {
+                return handle;
+            }
+            if (!infinite && std::chrono::steady_clock::now() >= deadline) {
+                return {};
+            }
+            // Registered before the next try, so a release in between either is found or wakes us.
+            ++waiting;
+            if (auto handle = tryAcquire()) {
+                --waiting;
+                return handle;
+            }
+#ifdef FLOW_HAS_FUTEX
+            if (infinite) {
+                FlowFutex::wait(releases, seen);
+            } else {
+                FlowFutex::waitFor(releases, seen, deadline - std::chrono::steady_clock::now());
+            }
+#else
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                const auto released = [&] { return releases.load() != seen; };
+                if (infinite) {
+                    condition.wait(lock, released);
+                } else {
+                    condition.wait_until(lock, deadline, released);
+                }
+            }
+#endif
+            --waiting;
+        }
+    }
+
+    void release(const uint32_t &index) {
+        uint32_t expected = NONE;
+        if (!caches[cacheIndex()].index.compare_exchange_strong(expected, index)) {
+            push(index);
+        }
+        ++releases;
+        if (waiting.load() != 0) {
+#ifdef FLOW_HAS_FUTEX
+            FlowFutex::wake(releases);
+#else
+            std::lock_guard<std::mutex> guard(mutex);
+            condition.notify_one();
+#endif
+        }
+    }
+
+    // An object may sit in another thread's cache slot while the stack is empty.
+    bool stealCached(uint32_t &index) {
+        for (size_t i = 0; i < cacheCount; ++i) {
+            index = caches[i].index.exchange(NONE);
+            if (index != NONE) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The head packs a tag, bumped by every change, above the top index so a CAS cannot succeed on a
+    // head that was popped and pushed back in between.
+    void push(const uint32_t &index) {
+        uint64_t current = head.load(std::memory_order_relaxed);
+        uint64_t replacement;
+        do {
+            next[index].store(static_cast<uint32_t>(current), std::memory_order_relaxed);
+            replacement = ((current >> 32) + 1) << 32 | index;
+        } while (!head.compare_exchange_weak(current, replacement, std::memory_order_release,
+                                             std::memory_order_relaxed));
+    }
+
+    bool pop(uint32_t &index) {
+        uint64_t current = head.load(std::memory_order_acquire);
+        uint64_t replacement;
+        do {
+            index = static_cast<uint32_t>(current);
+            if (index == NONE) {
+                return false;
+            }
+            replacement = ((current >> 32) + 1) << 32 | next[index].load(std::memory_order_relaxed);
+        } while (!head.compare_exchange_weak(current, replacement, std::memory_order_acquire,
+                                             std::memory_order_acquire));
+        return true;
+    }
+
+    const uint32_t capacity;
+    std::unique_ptr<std::optional<T>[]> objects;
+    std::unique_ptr<std::atomic<uint32_t>[]> next;
+    const size_t cacheCount;
+    std::unique_ptr<Cache[]> caches;
+    std::atomic<uint64_t> head = {NONE};
+    std::atomic<uint32_t> releases = {0};
+    std::atomic<uint32_t> waiting = {0};
+#ifndef FLOW_HAS_FUTEX
+    std::mutex mutex;
+    std::condition_variable condition;
+#endif
+};
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "Futex.h"
+
+// Single-consumer wake up token. unpark() leaves one permit that the next park() consumes, so a wake
+// up that races ahead of park() is never lost. park() spins for the configured window before it
+// sleeps on a futex (or a condition variable where futexes are unavailable); unpark() only enters
+// the kernel when the owner is actually asleep.
+class Parker {
+public:
+    explicit Parker(const std::chrono::nanoseconds &spinWindow = std::chrono::nanoseconds::zero())
+            : spinWindow(spinWindow) {}
+
+    void setSpinWindow(const std::chrono::nanoseconds &window) {
+        spinWindow = window;
+    }
+
+    std::chrono::nanoseconds getSpinWindow() const {
+        return spinWindow;
+    }
+
+    void park() {
+        parkUntil(std::chrono::steady_clock::time_point::max());
+    }
+
+    // Returns false when the timeout expired without a permit.
+    template<class Rep, class Period>
+    bool parkFor(const std::chrono::duration<Rep, Period> &timeout) {
+        return parkUntil(std::chrono::steady_clock::now() +
+                         std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout));
+    }
+
+    void unpark() {
+        if (state.exchange(NOTIFIED) == PARKED) {
+#ifdef FLOW_HAS_FUTEX
+            FlowFutex::wake(state);
+#else
+            std::lock_guard<std::mutex> guard(mutex);
+            condition.notify_one();
+#endif
+        }
+    }
+
+private:
+    bool parkUntil(const std::chrono::steady_clock::time_point &deadline) {
+        if (tryConsume()) {
+            return true;
+        }
+        const std::chrono::nanoseconds window = spinWindow;
+        if (window > std::chrono::nanoseconds::zero()) {
+            const auto spinEnd = std::chrono::steady_clock::now() + window;
+            do {
+                if (tryConsume()) {
+                    return true;
+                }
+                std::this_thread::yield();
+            } while (std::chrono::steady_clock::now() < spinEnd);
+        }
+        uint32_t expected = EMPTY;
+        if (!state.compare_exchange_strong(expected, PARKED)) {
+            state = EMPTY;
+            return true;
+        }
+        while (true) {
+            const bool infinite = deadline == std::chrono::steady_clock::time_point::max();
+#ifdef FLOW_HAS_FUTEX
+            if (infinite) {
+                FlowFutex::wait(state, PARKED);
+            } else {
+                FlowFutex::waitFor(state, PARKED, deadline - std::chrono::steady_clock::now());
+            }
+#else
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (infinite) {
+                    condition.wait(lock, [&] { return state != PARKED; });
+                } else {
+                    condition.wait_until(lock, deadline, [&] { return state != PARKED; });
+                }
+            }
+#endif
+            if (tryConsume()) {
+                return true;
+            }
+            if (!infinite && std::chrono::steady_clock::now() >= deadline) {
+                return state.exchange(EMPTY) == NOTIFIED;
+            }
+        }
+    }
+
+    bool tryConsume() {
+        uint32_t expected = NOTIFIED;
+        return state.compare_exchange_strong(expected, EMPTY);
+    }
+
+    static constexpr uint32_t EMPTY = 0;
+    static constexpr uint32_t NOTIFIED = 1;
+    static constexpr uint32_t PARKED = 2;
+
+    std::atomic<uint32_t> state = {EMPTY};
+    std::atomic<std::chrono::nanoseconds> spinWindow;
+#ifndef FLOW_HAS_FUTEX
+    std::mutex mutex;
+    std::condition_variable condition;
+#endif
+};
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Lock-free log-linear histogram in the style of HdrHistogram: every power of two is split into 16
+// linear sub-buckets, so any recorded value is reported within ~6% over the full 64 bit range.
+// record() is a couple of relaxed atomic adds and snapshot() may run concurrently from any thread.
+class LatencyHistogram {
+public:
+    static constexpr size_t subBucketBits = 4;
+    static constexpr size_t subBucketCount = size_t(1) << subBucketBits;
+    static constexpr size_t bucketCount = (64 - subBucketBits + 1) * subBucketCount;
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+        std::vector<uint64_t> buckets;
+
+        double mean() const {
+            return count == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(count);
+        }
+
+        // Upper bound of the bucket holding the given percentile (0..100), capped at max.
+        uint64_t percentile(const double &percent) const {
+            if (count == 0) {
+                return 0;
+            }
+            const double clamped = percent < 0 ? 0 : (percent > 100 ? 100 : percent);
+            uint64_t rank = static_cast<uint64_t>(clamped / 100.0 * static_cast<double>(count) + 0.5);
+            rank = rank == 0 ? 1 : rank;
+            uint64_t seen = 0;
+            for (size_t i = 0; i < buckets.size(); ++i) {
+                seen += buckets[i];
+                if (seen >= rank) {
+                    const uint64_t upper = upperBound(i);
+                    return upper < max ? upper : max;
+                }
+            }
+            return max;
+        }
+    };
+
+    void record(const uint64_t &value) {
+        counts[indexOf(value)].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t current = maximum.load(std::memory_order_relaxed);
+        while (value > current && !maximum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+        current = minimum.load(std::memory_order_relaxed);
+        while (value < current && !minimum.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Buckets are read one by one, so a snapshot taken under load may be off by the values recorded
+    // while it was copied.
+    Snapshot snapshot() const {
+        Snapshot result;
+        result.buckets.resize(bucketCount);
+        for (size_t i = 0; i < bucketCount; ++i) {
+            result.buckets[i] = counts[i].load(std::memory_order_relaxed);
+            result.count += result.buckets[i];
+        }
+        result.sum = sum.load(std::memory_order_relaxed);
+        result.max = maximum.load(std::memory_order_relaxed);
+        const uint64_t lowest = minimum.load(std::memory_order_relaxed);
+        result.min = result.count == 0 ? 0 : lowest;
+        return result;
+    }
+
+    static size_t indexOf(const uint64_t &value) {
+        if (value < subBucketCount) {
+            return static_cast<size_t>(value);
+        }
+        const size_t exponent = 63 - std::countl_zero(value);
+        const size_t shift = exponent - subBucketBits;
+        const size_t mantissa = static_cast<size_t>(value >> shift) & (subBucketCount - 1);
+        return (exponent - subBucketBits + 1) * subBucketCount + mantissa;
+    }
+
+    static uint64_t lowerBound(const size_t &index) {
+        if (index < subBucketCount) {
+            return index;
+        }
+        const size_t shift = index / subBucketCount - 1;
+        return (subBucketCount + index % subBucketCount) << shift;
+    }
+
+    static uint64_t upperBound(const size_t &index) {
+        if (index < subBucketCount) {
+            return index;
+        }
+        const size_t shift = index / subBucketCount - 1;
+        return lowerBound(index) + ((uint64_t(1) << shift) - 1);
+    }
+
+private:
+    std::unique_ptr<std::atomic<uint64_t>[]> counts{new std::atomic<uint64_t>[bucketCount]()};
+    std::atomic<uint64_t> sum = {0};
+    std::atomic<uint64_t> maximum = {0};
+    std::atomic<uint64_t> minimum = {UINT64_MAX};
+};
+
+struct PoolMetricsSnapshot {
+    size_t queueDepth = 0;
+    size_t busyWorkers = 0;
+    size_t idleWorkers = 0;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    double uptime = 0;
+    // Completed tasks per second since the pool was created; diff two snapshots for a recent rate.
+    double throughput = 0;
+    // Nanoseconds from enqueue to start and from start to finish.
+    LatencyHistogram::Snapshot waitTime;
+    LatencyHistogram::Snapshot runTime;
+};
+
+// Per pool counters. Pools only hold and feed one when built with FLOW_POOL_METRICS, otherwise none
+// of this is compiled into them.
+class PoolMetrics {
+public:
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Returns the enqueue timestamp to hand to taskStarted.
+    uint64_t taskQueued() {
+        submitted.fetch_add(1, std::memory_order_relaxed);
+        return now();
+    }
+
+    // A queued task that will never run, e.g. dropped or rejected after taskQueued.
+    void taskDiscarded() {
+        discarded.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Returns the start timestamp to hand to taskFinished.
+    uint64_t taskStarted(const uint64_t &queuedAt) {
+        const uint64_t startedAt = now();
+        started.fetch_add(1, std::memory_order_relaxed);
+        busy.fetch_add(1, std::memory_order_relaxed);
+        waitTime.record(startedAt > queuedAt ? startedAt - queuedAt : 0);
+        return startedAt;
+    }
+
+    void taskFinished(const uint64_t &startedAt) {
+        const uint64_t finishedAt = now();
+        runTime.record(finishedAt > startedAt ? finishedAt - startedAt : 0);
+        busy.fetch_sub(1, std::memory_order_relaxed);
+        completed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void setWorkers(const size_t &count) {
+        workers.store(count, std::memory_order_relaxed);
+    }
+
+    // Runs a dequeued task and records its wait and run time. Pools keep the taskQueued timestamp next
+    // to the task instead of wrapping it, which would push it out of InlineTask's inline buffer.
+    template<class Task, class... Args>
+    void run(const uint64_t &queuedAt, Task &task, Args &&... args) {
+        const Finish finish{*this, taskStarted(queuedAt)};
+        task(std::forward<Args>(args)...);
+    }
+
+    PoolMetricsSnapshot snapshot() const {
+        PoolMetricsSnapshot result;
+        const uint64_t startedCount = started.load(std::memory_order_relaxed);
+        const uint64_t gone = startedCount + discarded.load(std::memory_order_relaxed);
+        result.submitted = submitted.load(std::memory_order_relaxed);
+        result.queueDepth = result.submitted > gone ? result.submitted - gone : 0;
+        result.busyWorkers = busy.load(std::memory_order_relaxed);
+        const size_t workerCount = workers.load(std::memory_order_relaxed);
+        result.idleWorkers = workerCount > result.busyWorkers ? workerCount - result.busyWorkers : 0;
+        result.completed = completed.load(std::memory_order_relaxed);
+        result.uptime = static_cast<double>(now() - createdAt) / 1e9;
+        result.throughput = result.uptime > 0 ? static_cast<double>(result.completed) / result.uptime : 0;
+        result.waitTime = waitTime.snapshot();
+        result.runTime = runTime.snapshot();
+        return result;
+    }
+
+private:
+    struct Finish {
+        PoolMetrics &metrics;
+        const uint64_t startedAt;
+
+        ~Finish() {
+            metrics.taskFinished(startedAt);
+        }
+    };
+
+    const uint64_t createdAt = now();
+    std::atomic<uint64_t> submitted = {0};
+    std::atomic<uint64_t> started = {0};
+    std::atomic<uint64_t> discarded = {0};
+    std::atomic<uint64_t> completed = {0};
+    std::atomic_size_t busy = {0};
+    std::atomic_size_t workers = {0};
+    LatencyHistogram waitTime;
+    LatencyHistogram runTime;
+};
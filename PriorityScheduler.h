@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "MPMCQueue.h"
+
+// Multi-level priority store: one lock-free FIFO ring per priority level plus a 64 bit occupancy
+// bitmap, so push and pop are O(1) and tasks of the same priority keep their submission order.
+// Priorities above the highest level share the top level. Rings are only allocated for levels that
+// are used. A full ring spills into a locked overflow list of its level, so push() never fails and
+// a task queueing work on its own pool cannot wait for itself. With an aging interval of N, every Nth
+// pop serves the lowest occupied level instead of the highest so low priority work cannot starve.
+template<class T>
+class PriorityScheduler {
+public:
+    static constexpr size_t maxLevels = 64;
+
+    explicit PriorityScheduler(const size_t &levelCount = maxLevels,
+                               const size_t &capacityPerLevel = 1024,
+                               const size_t &agingInterval = 0) : levelCount(clampLevels(levelCount)),
+                                                                  capacityPerLevel(capacityPerLevel),
+                                                                  agingInterval(agingInterval) {}
+
+    ~PriorityScheduler() {
+        for (auto &level: levels) {
+            delete level.load();
+        }
+    }
+
+    PriorityScheduler(const PriorityScheduler &) = delete;
+
+    PriorityScheduler &operator=(const PriorityScheduler &) = delete;
+
+    // Fails when the ring of that priority level is full.
+    template<class U>
+    bool tryPush(U &&task, const size_t &priority) {
+        const size_t level = toLevel(priority);
+        Level &entry = getLevel(level);
+        if (entry.overflowCount.load() != 0 || !entry.ring.tryPush(std::forward<U>(task))) {
+            return false;
+        }
+        bitmap.fetch_or(uint64_t(1) << level);
+        return true;
+    }
+
+    // Queues into the overflow list once the ring is full. Once the list holds tasks every push goes
+    // there until it drained, so the level stays in submission order.
+    template<class U>
+    void push(U &&task, const size_t &priority) {
+        const size_t level = toLevel(priority);
+        Level &entry = getLevel(level);
+        if (entry.overflowCount.load() != 0 || !entry.ring.tryPush(std::forward<U>(task))) {
+            std::lock_guard<std::mutex> guard(entry.overflowMutex);
+            entry.overflow.emplace_back(std::forward<U>(task));
+            entry.overflowCount.fetch_add(1);
+        }
+        bitmap.fetch_or(uint64_t(1) << level);
+    }
+
+    bool tryPop(T &task) {
+        size_t level;
+        return tryPop(task, level);
+    }
+
+    // level receives the priority level the task was taken from.
+    bool tryPop(T &task, size_t &level) {
+        const bool aging = agingInterval != 0 && ++pops % agingInterval == 0;
+        while (true) {
+            const uint64_t occupied = bitmap.load();
+            if (occupied == 0) {
+                return false;
+            }
+            level = aging ? lowestBit(occupied) : highestBit(occupied);
+            if (popLevel(task, level)) {
+                return true;
+            }
+        }
+    }
+
+    // Pops the oldest task of the highest level strictly above minimumLevel, ignoring aging.
+    bool tryPopAbove(T &task, const size_t &minimumLevel, size_t &level) {
+        if (minimumLevel + 1 >= maxLevels) {
+            return false;
+        }
+        const uint64_t above = ~((uint64_t(1) << (minimumLevel + 1)) - 1);
+        while (true) {
+            const uint64_t occupied = bitmap.load() & above;
+            if (occupied == 0) {
+                return false;
+            }
+            level = highestBit(occupied);
+            if (popLevel(task, level)) {
+                return true;
+            }
+        }
+    }
+
+    // Pops the oldest task of the lowest occupied level, ignoring aging.
+    bool tryPopLowest(T &task) {
+        while (true) {
+            const uint64_t occupied = bitmap.load();
+            if (occupied == 0) {
+                return false;
+            }
+            if (popLevel(task, lowestBit(occupied))) {
+                return true;
+            }
+        }
+    }
+
+    // Highest occupied priority level, or -1 when nothing is queued.
+    int highestPending() const {
+        const uint64_t occupied = bitmap.load();
+        return occupied == 0 ? -1 : static_cast<int>(highestBit(occupied));
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (size_t i = 0; i < levelCount; ++i) {
+            const auto entry = levels[i].load(std::memory_order_acquire);
+            if (entry != nullptr) {
+                total += entry->ring.size() + entry->overflowCount.load();
+            }
+        }
+        return total;
+    }
+
+    bool empty() const {
+        return bitmap.load() == 0 && size() == 0;
+    }
+
+    size_t toLevel(const size_t &priority) const {
+        return priority < levelCount ? priority : levelCount - 1;
+    }
+
+private:
+    static size_t clampLevels(const size_t &levelCount) {
+        return levelCount == 0 ? 1 : (levelCount > maxLevels ? maxLevels : levelCount);
+    }
+
+    static size_t highestBit(const uint64_t value) {
+        return 63 - std::countl_zero(value);
+    }
+
+    static size_t lowestBit(const uint64_t value) {
+        return std::countr_zero(value);
+    }
+
+    struct Level {
+        explicit Level(const size_t &capacity) : ring(capacity) {}
+
+        bool empty() const {
+            return ring.empty() && overflowCount.load() == 0;
+        }
+
+        MPMCQueue<T> ring;
+        std::mutex overflowMutex;
+        std::deque<T> overflow;
+        std::atomic_size_t overflowCount = {0};
+    };
+
+    // The ring holds the older tasks of a level, so the overflow list is only served once it is empty.
+    // Clears the level's bit when both turn out to be empty, re-setting it if a push raced in.
+    bool popLevel(T &task, const size_t &level) {
+        auto &entry = *levels[level].load(std::memory_order_acquire);
+        if (entry.ring.tryPop(task)) {
+            return true;
+        }
+        if (entry.overflowCount.load() != 0) {
+            std::lock_guard<std::mutex> guard(entry.overflowMutex);
+            if (!entry.overflow.empty()) {
+                task = std::move(entry.overflow.front());
+                entry.overflow.pop_front();
+                entry.overflowCount.fetch_sub(1);
+                return true;
+            }
+        }
+        const uint64_t bit = uint64_t(1) << level;
+        bitmap.fetch_and(~bit);
+        if (!entry.empty()) {
+            bitmap.fetch_or(bit);
+        }
+        return false;
+    }
+
+    Level &getLevel(const size_t &level) {
+        auto entry = levels[level].load(std::memory_order_acquire);
+        if (entry != nullptr) {
+            return *entry;
+        }
+        auto created = new Level(capacityPerLevel);
+        if (levels[level].compare_exchange_strong(entry, created, std::memory_order_acq_rel)) {
+            return *created;
+        }
+        delete created;
+        return *entry;
+    }
+
+    const size_t levelCount;
+    const size_t capacityPerLevel;
+    const size_t agingInterval;
+    std::atomic<Level *> levels[maxLevels] = {};
+    alignas(64) std::atomic<uint64_t> bitmap = {0};
+    alignas(64) std::atomic_size_t pops = {0};
+};
@@ -3,21 +3,30 @@
 #include <thread>
 #include <vector>
 #include <functional>
-#include "MultiSemaphore.h"
+#include "CompletionLatch.h"
 #include "Semaphore.h"
 #include <queue>
 #include <atomic>
 #include "FlowLog.h"
+#include "InlineTask.h"
+#include "PriorityScheduler.h"
 #include <memory>
+#include <algorithm>
+#include <condition_variable>
 
 
 struct PriorityThread {
 
-    PriorityThread(std::shared_ptr<std::function<void()>> function, size_t priority) : toRun(function),
+    PriorityThread(std::shared_ptr<std::function<void()>> function, size_t priority) : toRun([function] {
+                                                                                           (*function)();
+                                                                                       }),
                                                                                        priority(
                                                                                                priority) {}
 
-    std::shared_ptr<std::function<void()>> toRun;
+    PriorityThread(InlineTask function, size_t priority) : toRun(std::move(function)),
+                                                           priority(priority) {}
+
+    InlineTask toRun;
     size_t priority;
 
     bool operator<(const PriorityThread &b) const {
@@ -28,17 +37,78 @@ struct PriorityThread {
 class PriorityThreadPool {
 public:
 
-    PriorityThreadPool(const size_t &threadLimit) {
+    // A persistent pool keeps threadLimit long-lived threads that pull from a PriorityScheduler instead
+    // of spawning a detached thread per function; functions then start as soon as they are added.
+    PriorityThreadPool(const size_t &threadLimit, const bool &persistent = false, const size_t &agingInterval = 0)
+            : persistent(persistent), scheduler(PriorityScheduler<InlineTask>::maxLevels, 1024, agingInterval) {
         this->threadLimit = threadLimit;
+        if (persistent) {
+            for (size_t i = 0; i < threadLimit; ++i) {
+                threads.emplace_back([this] {
+                    persistentThread();
+                });
+            }
+        }
+    }
+
+    ~PriorityThreadPool() {
+        if (persistent) {
+            {
+                std::lock_guard<std::mutex> guard(sleepMutex);
+                isStopping = true;
+            }
+            sleepCondition.notify_all();
+            for (auto &thread: threads) {
+                thread.join();
+            }
+        }
     }
 
     void addFunction(std::shared_ptr<std::function<void()>> toRun, size_t priority) {
+        addFunction(InlineTask([toRun] {
+            (*toRun)();
+        }), priority);
+    }
+
+    void addFunction(InlineTask toRun, size_t priority) {
+        if (persistent) {
+            toWaitFor.addLock();
+            scheduler.push(std::move(toRun), priority);
+            if (sleeping > 0) {
+                std::lock_guard<std::mutex> guard(sleepMutex);
+                sleepCondition.notify_one();
+            }
+            return;
+        }
         std::lock_guard guard(functionsMutex);
         toWaitFor.addLock();
-        functions.emplace(toRun, priority);
+        functions.emplace_back(std::move(toRun), priority);
+        std::push_heap(functions.begin(), functions.end());
+    }
+
+    // Preemption point for long functions on a persistent pool: runs every queued function with a
+    // higher priority than the calling one before returning. Returns whether anything ran.
+    static bool yieldIfHigherPriorityPending() {
+        const auto pool = currentPool;
+        if (pool == nullptr) {
+            return false;
+        }
+        const size_t priority = currentPriority;
+        InlineTask task;
+        size_t level;
+        bool yielded = false;
+        while (pool->scheduler.tryPopAbove(task, priority, level)) {
+            pool->run(task, level);
+            yielded = true;
+        }
+        currentPriority = priority;
+        return yielded;
     }
 
     void start() {
+        if (persistent) {
+            return;
+        }
         std::unique_lock<std::mutex> lock(poolMutex, std::try_to_lock);
         if (lock.owns_lock()) {
             startThreads();
@@ -53,32 +123,75 @@ public:
     }
 
 private:
+    void run(InlineTask &task, const size_t &level) {
+        currentPriority = level;
+        try {
+            task();
+        } catch (const std::exception &e) {
+            LOG_WARNING << "Task failed: " << e.what();
+        }
+        task = nullptr;
+        toWaitFor.unlock();
+    }
+
+    void persistentThread() {
+        currentPool = this;
+        InlineTask task;
+        size_t level;
+        while (true) {
+            if (scheduler.tryPop(task, level)) {
+                run(task, level);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            ++sleeping;
+            sleepCondition.wait(lock, [&] {
+                return !scheduler.empty() || isStopping;
+            });
+            --sleeping;
+            if (isStopping && scheduler.empty()) {
+                return;
+            }
+        }
+    }
+
     void startThreads() {
         while (runningThreads < threadLimit && !functions.empty()) {
             try {
                 std::lock_guard guard(functionsMutex);
-                auto toRun = functions.top();
-                std::thread([&, toRun] {
+                std::pop_heap(functions.begin(), functions.end());
+                auto toRun = std::move(functions.back());
+                std::thread([&, toRun = std::move(toRun)]() mutable {
                     ++runningThreads;
-                    toRun.toRun->operator()();
+                    toRun.toRun();
                     --runningThreads;
                     start();
                     toWaitFor.unlock();
                 }).detach();
-                functions.pop();
+                functions.pop_back();
             } catch (const std::system_error &e) {
                 LOG_WARNING << "Code " << e.code()
                             << " meaning " << e.what() << '\n';
-                functions.pop();
+                functions.pop_back();
                 --runningThreads;
             }
         }
     }
 
-    std::priority_queue<PriorityThread> functions;
+    static inline thread_local PriorityThreadPool *currentPool = nullptr;
+    static inline thread_local size_t currentPriority = 0;
+
+    const bool persistent;
+    std::vector<PriorityThread> functions;
+    PriorityScheduler<InlineTask> scheduler;
+    std::vector<std::thread> threads;
+    std::atomic_size_t sleeping = {0};
+    std::atomic_bool isStopping = {false};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
     size_t threadLimit;
     std::atomic_size_t runningThreads = {0};
-    MultiSemaphore toWaitFor;
+    PendingTasks toWaitFor;
     std::mutex poolMutex;
     std::mutex functionsMutex;
 };
@@ -1,16 +1,27 @@
 #pragma once
 
+#include <atomic>
 #include <thread>
 #include <functional>
+#include <utility>
 #include "Semaphore.h"
+#include "InlineTask.h"
+#include "FlowAffinity.h"
+#include "PoolMetrics.h"
+#include "CancellationToken.h"
 
 struct PriorityTask {
 
     PriorityTask(const std::shared_ptr<std::function<void()>> &function,
-                 size_t priority) : toRun(function),
+                 size_t priority) : toRun([function] {
+                                        (*function)();
+                                    }),
                                     priority(priority) {}
 
-    std::shared_ptr<std::function<void()>> toRun;
+    PriorityTask(InlineTask function, size_t priority) : toRun(std::move(function)),
+                                                         priority(priority) {}
+
+    InlineTask toRun;
     size_t priority;
 
     bool operator<(const PriorityTask &b) const {
@@ -35,21 +46,66 @@ public:
     }
 
     void assignTask(const std::shared_ptr<PriorityTask> &task) {
-        currentTask = task;
+        assignTask(InlineTask([task] {
+            task->toRun();
+        }));
+    }
+
+    void assignTask(PriorityTask task) {
+        assignTask(std::move(task.toRun));
+    }
+
+    void assignTask(InlineTask task) {
+        currentTask = std::move(task);
+        assigned.store(true, std::memory_order_release);
         runTask();
     }
 
+    // The next task runs with token as CancellationToken::current().
+    void cancelWith(CancellationToken token) {
+        currentToken = std::move(token);
+    }
+
+#ifdef FLOW_POOL_METRICS
+
+    // The next task's wait and run time go to metrics; queuedAt is its PoolMetrics::taskQueued() stamp.
+    void trackNext(PoolMetrics &poolMetrics, const uint64_t &taskQueuedAt) {
+        metrics = &poolMetrics;
+        queuedAt = taskQueuedAt;
+    }
+
+#endif
+
     const size_t getId() {
         return id;
     }
 
+    // Binds the worker thread according to the placement; returns false when it stays unbound.
+    bool pin(const FlowAffinity::Placement &toPin) {
+        placement = toPin;
+        return FlowAffinity::pin(mainThread, placement);
+    }
+
+    // Cpu the worker is pinned to, -1 when it is unbound or bound to a whole node.
+    int getCpu() const {
+        return placement.cpu;
+    }
+
+    // Index into FlowAffinity::Topology::nodes, -1 when the worker is unbound.
+    int getNode() const {
+        return placement.node;
+    }
+
     void stop() {
         state = STOPPED;
         mainSemaphore.unlock();
     }
 
+    // A no-op on the worker's own thread, which cannot join itself.
     void join() {
-        mainThread.join();
+        if (mainThread.joinable() && mainThread.get_id() != std::this_thread::get_id()) {
+            mainThread.join();
+        }
     }
 
     void detach() {
@@ -64,7 +120,7 @@ public:
         onStopCallback = callback;
     }
 
-    WorkerState state = IDLE;
+    std::atomic<WorkerState> state = {IDLE};
 private:
     const std::size_t id;
 
@@ -72,23 +128,49 @@ private:
         return std::thread([&] {
             while (state != STOPPED) {
                 mainSemaphore.lock();
-                if (currentTask == nullptr) {
+                // A wake without a task (the first lock(), stop) leaves currentTask to assignTask.
+                if (!assigned.load(std::memory_order_acquire)) {
                     continue;
                 }
                 if (state == STOPPED) {
                     fireStopCallback();
                     return;
                 }
-                currentTask->toRun->operator()();
+                runCurrentTask();
                 currentTask = nullptr;
-                state = IDLE;
+                assigned.store(false, std::memory_order_relaxed);
+                // A stop() that arrived during the run wins; overwriting it would park the worker for good.
+                WorkerState running = RUNNING;
+                state.compare_exchange_strong(running, IDLE);
                 fireIdleCallback();
             }
         });
     }
 
+    void runCurrentTask() {
+        if (currentToken.canBeCancelled()) {
+            const CancellationScope scope(std::exchange(currentToken, {}));
+            runTrackedTask();
+            return;
+        }
+        runTrackedTask();
+    }
+
+    void runTrackedTask() {
+#ifdef FLOW_POOL_METRICS
+        if (metrics != nullptr) {
+            metrics->run(queuedAt, currentTask);
+            metrics = nullptr;
+            return;
+        }
+#endif
+        currentTask();
+    }
+
+    // A stopped worker stays stopped and hands the task back through the stop callback.
     void runTask() {
-        state = RUNNING;
+        WorkerState idle = IDLE;
+        state.compare_exchange_strong(idle, RUNNING);
         mainSemaphore.unlock();
     }
 
@@ -104,9 +186,16 @@ private:
         }
     }
 
+    FlowAffinity::Placement placement;
     Semaphore mainSemaphore;
+    std::atomic_bool assigned = {false};
     std::thread mainThread;
-    std::shared_ptr<PriorityTask> currentTask;
+    InlineTask currentTask;
+    CancellationToken currentToken;
+#ifdef FLOW_POOL_METRICS
+    PoolMetrics *metrics = nullptr;
+    uint64_t queuedAt = 0;
+#endif
     std::shared_ptr<std::function<void(PriorityWorker *worker)>> onIdleCallback;
     std::shared_ptr<std::function<void(PriorityWorker *worker)>> onStopCallback;
 };
\ No newline at end of file
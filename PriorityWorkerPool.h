@@ -4,24 +4,41 @@
 #include <memory>
 #include <functional>
 #include <mutex>
-#include "MultiSemaphore.h"
+#include "CompletionLatch.h"
 #include <queue>
+#include "PriorityScheduler.h"
 #include "PriorityWorker.h"
+#include "FlowAffinity.h"
+#include "PoolMetrics.h"
+#include "CancellationToken.h"
+#include "AdmissionControl.h"
+#include "FlowTask.h"
 #include <functional>
 #include <map>
 
 class PriorityWorkerPool {
 public:
-    PriorityWorkerPool(const size_t &workerCount = std::thread::hardware_concurrency()) : workerCount(workerCount) {
+    // Priorities map to levels 0..levelCount-1 (higher runs first, larger values share the top level).
+    // agingInterval N lets every Nth dispatch serve the lowest pending priority; 0 disables aging.
+    PriorityWorkerPool(const size_t &workerCount = std::thread::hardware_concurrency(),
+                       const size_t &agingInterval = 0,
+                       const size_t &levelCount = PriorityScheduler<InlineTask>::maxLevels,
+                       const size_t &capacityPerLevel = 1024,
+                       const FlowAffinity::AffinityPolicy &affinity = {}) : tasks(levelCount, capacityPerLevel,
+                                                                                  agingInterval),
+                                                                            workerCount(workerCount) {
+        const auto &topology = FlowAffinity::Topology::get();
         for (int i = 0; i < workerCount; ++i) {
             auto worker = std::make_shared<PriorityWorker>(workerId);
+            worker->pin(topology.place(affinity, i));
             workerMap[workerId] = worker;
             ++workerId;
             const auto onIdleCallback =
                     std::make_shared < std::function < void(PriorityWorker * worker) >> ([&](PriorityWorker *worker) {
                         std::unique_lock <std::mutex> lock(poolMutex);
                         toWaitFor.unlock();
-                        idleWorker.push(workerMap.at(worker->getId()));
+                        if (!isStopping)
+                            idleWorker.push(workerMap.at(worker->getId()));
                         startWorker();
                     });
             worker->onIdle(onIdleCallback);
@@ -33,12 +50,109 @@ public:
             worker->onStop(onStopCallback);
             idleWorker.push(worker);
         }
+#ifdef FLOW_POOL_METRICS
+        metrics.setWorkers(workerCount);
+#endif
     }
 
-    void addTask(std::shared_ptr<std::function<void()>> function, size_t priority) {
-        std::lock_guard guard(tasksMutex);
-        toWaitFor.addLock();
-        tasks.emplace(std::make_shared<PriorityTask>(function, priority));
+    // Joins the workers before any member goes: a worker finishing its last task still runs the idle
+    // callback, which touches idleWorker and the scheduler.
+    ~PriorityWorkerPool() {
+        stop();
+        for (const auto &entry: workerMap) {
+            entry.second->join();
+        }
+    }
+
+    SubmitResult addTask(std::shared_ptr<std::function<void()>> function, size_t priority) {
+        return addTask(InlineTask([function] {
+            (*function)();
+        }), priority);
+    }
+
+    SubmitResult addTask(InlineTask function, size_t priority) {
+        return addTask(CancellableTask(std::move(function)), priority);
+    }
+
+    // The task is shed instead of run if the token is cancelled or the deadline has passed by the
+    // time a worker would take it; while it runs, CancellationToken::current() returns the token.
+    SubmitResult addTask(InlineTask function, size_t priority, const CancellationToken &token,
+                         const CancellableTask::Clock::time_point &deadline =
+                         CancellableTask::Clock::time_point::max()) {
+        return addTask(CancellableTask(std::move(function), token, deadline), priority);
+    }
+
+    // Applies the admission policy once the queue is full, see setAdmission.
+    SubmitResult addTask(CancellableTask task, size_t priority) {
+        return submit(std::move(task), priority, true);
+    }
+
+    // Never blocks or runs the task on the caller: a full queue rejects it whatever the policy.
+    SubmitResult trySubmit(InlineTask function, size_t priority) {
+        return trySubmit(CancellableTask(std::move(function)), priority);
+    }
+
+    SubmitResult trySubmit(CancellableTask task, size_t priority) {
+        return submit(std::move(task), priority, false);
+    }
+
+    // co_await pool.schedule(priority) continues the coroutine on a worker at that priority and starts
+    // the pool. The co_await throws if the pool rejects or sheds the coroutine instead.
+    auto schedule(size_t priority) {
+        return FlowCoroutine::ScheduleAwaiter([this, priority](InlineTask task) {
+            const SubmitResult result = addTask(std::move(task), priority);
+            start();
+            return result;
+        });
+    }
+
+    // Caps the number of queued tasks (0 means unbounded, the default) and picks what addTask does
+    // once the cap is reached. DROP_OLDEST sheds the oldest task of the lowest pending priority.
+    void setAdmission(const size_t &capacity, const AdmissionPolicy &policy = AdmissionPolicy::BLOCK) {
+        admission.setLimit(capacity, policy);
+    }
+
+    size_t getHighWaterMark() const {
+        return admission.getHighWaterMark();
+    }
+
+    size_t getRejectedCount() const {
+        return admission.getRejectedCount();
+    }
+
+    // Tasks dropped without running because they were cancelled, expired or still queued at stop().
+    size_t getShedCount() const {
+        return shed;
+    }
+
+    // Tasks handed to a worker.
+    size_t getExecutedCount() const {
+        return executed;
+    }
+
+    // Sheds every queued task and returns how many there were; running tasks are not affected.
+    size_t cancelQueued() {
+        size_t count = 0;
+        CancellableTask entry;
+        while (tasks.tryPop(entry)) {
+            admission.release();
+            discard(entry);
+            ++count;
+        }
+        return count;
+    }
+
+    // Stops the workers once they finish their current task and sheds everything still queued.
+    void stop() {
+        isStopping = true;
+        for (const auto &entry: workerMap) {
+            entry.second->stop();
+        }
+        cancelQueued();
+    }
+
+    size_t size() const {
+        return tasks.size();
     }
 
     void start() {
@@ -48,32 +162,55 @@ public:
         }
     }
 
+    // Where the worker with that id is pinned; a default Placement for unknown ids.
+    FlowAffinity::Placement getPlacement(const size_t &id) const {
+        const auto entry = workerMap.find(id);
+        if (entry == workerMap.end()) {
+            return {};
+        }
+        return {entry->second->getCpu(), entry->second->getNode()};
+    }
+
+#ifdef FLOW_POOL_METRICS
+
+    PoolMetricsSnapshot getMetrics() const {
+        return metrics.snapshot();
+    }
+
+#endif
+
     void join() {
         isJoin = true;
+        start();
         toWaitFor.wait();
-        while (!tasks.empty()) {
-            start();
-            toWaitFor.wait();
-            for (const auto& entry : workerMap) {
-                entry.second->join();
-            }
+        stop();
+        for (const auto &entry: workerMap) {
+            entry.second->join();
         }
     }
 
 private:
     void startWorker() {
         std::lock_guard guard(tasksMutex);
-        while (!tasks.empty() && !idleWorker.empty()) {
+        CancellableTask toRun;
+        while (!idleWorker.empty() && tasks.tryPop(toRun)) {
+            admission.release();
+            if (toRun.expired()) {
+                discard(toRun);
+                continue;
+            }
             try {
-                const auto toRun = tasks.top();
                 const auto worker = idleWorker.front();
                 idleWorker.pop();
-                worker->assignTask(toRun);
-                tasks.pop();
+                ++executed;
+#ifdef FLOW_POOL_METRICS
+                worker->trackNext(metrics, toRun.queuedAt);
+#endif
+                worker->cancelWith(std::move(toRun.token));
+                worker->assignTask(std::move(toRun.task));
             } catch (const std::system_error &e) {
                 LOG_WARNING << "Code " << e.code()
                             << " meaning " << e.what() << '\n';
-                tasks.pop();
                 toWaitFor.unlock();
             }
         }
@@ -84,13 +221,74 @@ private:
         }
     }
 
-    bool isJoin = false;
+    SubmitResult submit(CancellableTask task, const size_t &priority, const bool &mayBlock) {
+#ifdef FLOW_POOL_METRICS
+        task.queuedAt = metrics.taskQueued();
+#endif
+        const size_t capacity = admission.getCapacity();
+        if (capacity != 0 && admission.size() >= capacity) {
+            start();
+        }
+        const SubmitResult result = admission.admit(mayBlock, [&] {
+            toWaitFor.addLock();
+            tasks.push(std::move(task), priority);
+        }, [&] {
+            CancellableTask oldest;
+            if (!tasks.tryPopLowest(oldest)) {
+                return false;
+            }
+            admission.release();
+            discard(oldest);
+            return true;
+        }, [&] {
+            if (task.expired()) {
+                ++shed;
+#ifdef FLOW_POOL_METRICS
+                metrics.taskDiscarded();
+#endif
+            } else {
+                ++executed;
+#ifdef FLOW_POOL_METRICS
+                const CancellationScope scope(task.token);
+                metrics.run(task.queuedAt, task.task);
+#else
+                task.run();
+#endif
+            }
+        });
+#ifdef FLOW_POOL_METRICS
+        if (result == SubmitResult::REJECTED) {
+            metrics.taskDiscarded();
+        }
+#endif
+        return result;
+    }
+
+    // The task goes last, see WorkerPool::discard.
+    void discard(CancellableTask &entry) {
+        ++shed;
+#ifdef FLOW_POOL_METRICS
+        metrics.taskDiscarded();
+#endif
+        toWaitFor.unlock();
+        entry.task = nullptr;
+    }
+
+    std::atomic_bool isStopping = {false};
+    std::atomic_bool isJoin = {false};
     std::atomic_size_t workerId;
-    std::priority_queue <std::shared_ptr<PriorityTask>> tasks;
-    MultiSemaphore toWaitFor;
+    std::atomic_size_t shed = {0};
+    std::atomic_size_t executed = {0};
+    PriorityScheduler<CancellableTask> tasks;
+    AdmissionControl admission;
+    PendingTasks toWaitFor;
     std::mutex poolMutex;
     std::mutex tasksMutex;
     size_t workerCount;
+    // Ahead of the worker containers, whose destruction joins workers that may still be running a task.
+#ifdef FLOW_POOL_METRICS
+    PoolMetrics metrics;
+#endif
     std::queue <std::shared_ptr<PriorityWorker>> idleWorker;
     std::unordered_map <size_t, std::shared_ptr<PriorityWorker>> workerMap;
 };
\ No newline at end of file
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+#include "Futex.h"
+
+// Reader-writer lock for read-mostly data. Readers count themselves on one of hardware_concurrency()
+// cache line sized slots, picked per thread, so concurrent readers on different cores never write the
+// same line. A writer raises a flag that turns new readers away and waits for every slot to drain,
+// which makes writes expensive and the lock writer preferring. Meets the SharedMutex requirements,
+// so std::shared_lock, std::unique_lock and std::lock_guard work as RAII guards; read() and write()
+// return them.
+class ReaderWriterLock {
+public:
+    explicit ReaderWriterLock(const size_t &slotCount = std::thread::hardware_concurrency())
+            : slots(slotCount == 0 ? 1 : slotCount) {}
+
+    ReaderWriterLock(const ReaderWriterLock &) = delete;
+
+    ReaderWriterLock &operator=(const ReaderWriterLock &) = delete;
+
+    [[nodiscard]] std::shared_lock<ReaderWriterLock> read() {
+        return std::shared_lock<ReaderWriterLock>(*this);
+    }
+
+    [[nodiscard]] std::unique_lock<ReaderWriterLock> write() {
+        return std::unique_lock<ReaderWriterLock>(*this);
+    }
+
+    void lock_shared() {
+        auto &readers = slot().readers;
+        while (true) {
+            readers.fetch_add(1);
+            if (writer.load() == 0) {
+                return;
+            }
+            leave(readers);
+            waitFor(writer, 1);
+        }
+    }
+
+    bool try_lock_shared() {
+        auto &readers = slot().readers;
+        readers.fetch_add(1);
+        if (writer.load() == 0) {
+            return true;
+        }
+        leave(readers);
+        return false;
+    }
+
+    void unlock_shared() {
+        leave(slot().readers);
+    }
+
+    void lock() {
+        writerMutex.lock();
+        writer.store(1);
+        for (auto &entry: slots) {
+            while (true) {
+                const uint32_t seen = drained.load();
+                if (entry.readers.load() == 0) {
+                    break;
+                }
+                waitFor(drained, seen);
+            }
+        }
+    }
+
+    bool try_lock() {
+        if (!writerMutex.try_lock()) {
+            return false;
+        }
+        writer.store(1);
+        for (auto &entry: slots) {
+            if (entry.readers.load() != 0) {
+                unlock();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void unlock() {
+        writer.store(0);
+        wakeAll(writer);
+        writerMutex.unlock();
+    }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic_size_t readers = {0};
+    };
+
+    Slot &slot() {
+        static std::atomic_size_t threadCount = {0};
+        static thread_local const size_t threadIndex = threadCount++;
+        return slots[threadIndex % slots.size()];
+    }
+
+    // The last reader of a slot to leave while a writer waits tells it to look again.
+    void leave(std::atomic_size_t &readers) {
+        if (readers.fetch_sub(1) == 1 && writer.load() != 0) {
+            ++drained;
+            wakeAll(drained);
+        }
+    }
+
+    static void waitFor(std::atomic<uint32_t> &word, const uint32_t &expected) {
+#ifdef FLOW_HAS_FUTEX
+        FlowFutex::wait(word, expected);
+#else
+        while (word.load() == expected) {
+            std::this_thread::yield();
+        }
+#endif
+    }
+
+    static void wakeAll(std::atomic<uint32_t> &word) {
+#ifdef FLOW_HAS_FUTEX
+        FlowFutex::wakeAll(word);
+#endif
+    }
+
+    std::vector<Slot> slots;
+    std::atomic<uint32_t> writer = {0};
+    std::atomic<uint32_t> drained = {0};
+    std::mutex writerMutex;
+};
@@ -0,0 +1,258 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Pool of connection-like resources held by value. Up to maxSize objects live in one array that
+// never moves, so handles refer to the pooled object itself and nothing is copied. Objects are made
+// by the factory when a checkout finds none idle (or up front with prewarm()); the validator runs
+// on checkout and on return, and an object failing it is destroyed and its slot made again later.
+// The factory and validator run without the pool's lock held. Slow or stuck holders show up in
+// leakReport().
+template<class T>
+class ResourcePool {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Factory = std::function<T()>;
+    using Validator = std::function<bool(T &)>;
+
+    // A handle checked out for longer than the leak report threshold.
+    struct Leak {
+        size_t slot;
+        Clock::duration age;
+        std::thread::id owner;
+    };
+
+    class Handle {
+    public:
+        Handle() = default;
+
+        Handle(Handle &&other) noexcept : pool(std::exchange(other.pool, nullptr)), slot(other.slot) {}
+
+        Handle &operator=(Handle &&other) noexcept {
+            if (this != &other) {
+                reset();
+                pool = std::exchange(other.pool, nullptr);
+                slot = other.slot;
+            }
+            return *this;
+        }
+
+        Handle(const Handle &) = delete;
+
+        Handle &operator=(const Handle &) = delete;
+
+        ~Handle() {
+            reset();
+        }
+
+        explicit operator bool() const {
+            return pool != nullptr;
+        }
+
+        T &operator*() const {
+            return *get();
+        }
+
+        T *operator->() const {
+            return get();
+        }
+
+        T *get() const {
+            return pool == nullptr ? nullptr : &*pool->slots[slot].object;
+        }
+
+        // Returns the object to the pool early.
+        void reset() {
+            if (pool != nullptr) {
+                std::exchange(pool, nullptr)->release(slot, false);
+            }
+        }
+
+        // Destroys the object instead of returning it, e.g. after a broken connection.
+        void discard() {
+            if (pool != nullptr) {
+                std::exchange(pool, nullptr)->release(slot, true);
+            }
+        }
+
+    private:
+        friend class ResourcePool;
+
+        Handle(ResourcePool *pool, const size_t &slot) : pool(pool), slot(slot) {}
+
+        ResourcePool *pool = nullptr;
+        size_t slot = 0;
+    };
+
+    ResourcePool(const size_t &maxSize, Factory factory, Validator validator = {})
+            : maxSize(maxSize), slots(std::make_unique<Slot[]>(maxSize)), factory(std::move(factory)),
+              validator(std::move(validator)) {
+        empty.reserve(maxSize);
+        idle.reserve(maxSize);
+        for (size_t i = maxSize; i-- > 0;) {
+            empty.push_back(i);
+        }
+    }
+
+    ResourcePool(const ResourcePool &) = delete;
+
+    ResourcePool &operator=(const ResourcePool &) = delete;
+
+    // Creates objects until count of them are idle or the pool is full.
+    void prewarm(const size_t &count) {
+        while (true) {
+            size_t slot;
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (idle.size() >= count || empty.empty()) {
+                    return;
+                }
+                slot = empty.back();
+                empty.pop_back();
+            }
+            create(slot);
+            std::lock_guard<std::mutex> guard(mutex);
+            idle.push_back(slot);
+            condition.notify_one();
+        }
+    }
+
+    [[nodiscard]] Handle acquire() {
+        return acquireUntil(Clock::time_point::max());
+    }
+
+    // An empty handle when every object is checked out and the pool is full.
+    [[nodiscard]] Handle tryAcquire() {
+        return acquireUntil(Clock::time_point::min());
+    }
+
+    template<class Rep, class Period>
+    [[nodiscard]] Handle tryAcquireFor(const std::chrono::duration<Rep, Period> &timeout) {
+        return acquireUntil(Clock::now() + std::chrono::duration_cast<Clock::duration>(timeout));
+    }
+
+    std::vector<Leak> leakReport(const Clock::duration &threshold) const {
+        std::vector<Leak> leaks;
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> guard(mutex);
+        for (size_t i = 0; i < maxSize; ++i) {
+            const Slot &slot = slots[i];
+            if (slot.owner != std::thread::id() && now - slot.checkedOut >= threshold) {
+                leaks.push_back({i, now - slot.checkedOut, slot.owner});
+            }
+        }
+        return leaks;
+    }
+
+    // Objects currently alive, idle or checked out.
+    size_t size() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return maxSize - empty.size();
+    }
+
+    size_t idleCount() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return idle.size();
+    }
+
+    size_t getMaxSize() const {
+        return maxSize;
+    }
+
+    // Objects destroyed because they failed validation or were discarded.
+    size_t getDiscardedCount() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return discarded;
+    }
+
+private:
+    struct Slot {
+        std::optional<T> object;
+        // Set while a handle holds the object, for the leak report.
+        Clock::time_point checkedOut;
+        std::thread::id owner;
+    };
+
+    Handle acquireUntil(const Clock::time_point &deadline) {
+        while (true) {
+            size_t slot;
+            bool fresh;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (idle.empty() && empty.empty()) {
+                    if (deadline == Clock::time_point::max()) {
+                        condition.wait(lock);
+                    } else if (condition.wait_until(lock, deadline) == std::cv_status::timeout &&
+                               idle.empty() && empty.empty()) {
+                        return {};
+                    }
+                }
+                fresh = idle.empty();
+                auto &from = fresh ? empty : idle;
+                slot = from.back();
+                from.pop_back();
+            }
+            if (fresh) {
+                create(slot);
+            } else if (validator && !validator(*slots[slot].object)) {
+                destroy(slot);
+                continue;
+            }
+            std::lock_guard<std::mutex> guard(mutex);
+            slots[slot].checkedOut = Clock::now();
+            slots[slot].owner = std::this_thread::get_id();
+            return {this, slot};
+        }
+    }
+
+    // A factory that throws leaves the slot free for the next attempt.
+    void create(const size_t &slot) {
+        try {
+            slots[slot].object.emplace(factory());
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(mutex);
+            empty.push_back(slot);
+            condition.notify_one();
+            throw;
+        }
+    }
+
+    void destroy(const size_t &slot) {
+        slots[slot].object.reset();
+        std::lock_guard<std::mutex> guard(mutex);
+        slots[slot].owner = {};
+        empty.push_back(slot);
+        ++discarded;
+        condition.notify_one();
+    }
+
+    void release(const size_t &slot, const bool &broken) {
+        if (broken || (validator && !validator(*slots[slot].object))) {
+            destroy(slot);
+            return;
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        slots[slot].owner = {};
+        idle.push_back(slot);
+        condition.notify_one();
+    }
+
+    const size_t maxSize;
+    std::unique_ptr<Slot[]> slots;
+    Factory factory;
+    Validator validator;
+    // Slots with an idle object, most recently returned last, and slots without an object.
+    std::vector<size_t> idle;
+    std::vector<size_t> empty;
+    size_t discarded = 0;
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+};
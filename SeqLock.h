@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+
+// Sequence lock for small trivially copyable snapshots. Readers never write shared memory: they copy
+// the value and retry if a writer was active meanwhile, so they are wait free while nobody writes.
+// Writers are serialised by a mutex and bump the sequence to odd while they store. The value is kept
+// in relaxed atomic words, so torn copies that get retried are not data races.
+template<class T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>,
+                  "SeqLock needs a trivially copyable, default constructible type");
+
+public:
+    // Publishes the modified copy when destroyed; holds off other writers, never readers.
+    class Writer {
+    public:
+        explicit Writer(SeqLock &owner) : owner(owner), guard(owner.writerMutex), value(owner.read()) {}
+
+        ~Writer() {
+            owner.publish(value);
+        }
+
+        Writer(const Writer &) = delete;
+
+        Writer &operator=(const Writer &) = delete;
+
+        T &operator*() {
+            return value;
+        }
+
+        T *operator->() {
+            return &value;
+        }
+
+    private:
+        SeqLock &owner;
+        std::lock_guard<std::mutex> guard;
+        T value;
+    };
+
+    explicit SeqLock(const T &initial = T()) {
+        publish(initial);
+    }
+
+    SeqLock(const SeqLock &) = delete;
+
+    SeqLock &operator=(const SeqLock &) = delete;
+
+    T load() const {
+        while (true) {
+            const size_t before = sequence.load(std::memory_order_acquire);
+            if ((before & 1) != 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            const T value = read();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) {
+                return value;
+            }
+        }
+    }
+
+    void store(const T &value) {
+        std::lock_guard<std::mutex> guard(writerMutex);
+        publish(value);
+    }
+
+    // auto writer = lock.modify(); writer->field = 1; publishes the change when writer goes away.
+    [[nodiscard]] Writer modify() {
+        return Writer(*this);
+    }
+
+private:
+    static constexpr size_t wordCount = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    T read() const {
+        std::array<uint64_t, wordCount> buffer;
+        for (size_t i = 0; i < wordCount; ++i) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy(&value, buffer.data(), sizeof(T));
+        return value;
+    }
+
+    void publish(const T &value) {
+        std::array<uint64_t, wordCount> buffer{};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+        const size_t current = sequence.load(std::memory_order_relaxed);
+        sequence.store(current + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < wordCount; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        sequence.store(current + 2, std::memory_order_release);
+    }
+
+    std::atomic_size_t sequence = {0};
+    std::array<std::atomic<uint64_t>, wordCount> words{};
+    std::mutex writerMutex;
+};
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+#include "FlowLog.h"
+
+// IntervalRunner on a monotonic clock. Runs are scheduled on the absolute grid
+// firstRun + n * runEvery, so neither a wall clock jump nor the time spent in toRun moves later runs,
+// and Stop() interrupts the wait at once. When a run overruns one or more grid points the
+// MissedTicks policy decides what happens to them. A non-zero jitter starts each run a random
+// amount of up to jitter (at most runEvery) after its grid point, which keeps runners started together
+// from firing in lockstep; the grid itself never moves.
+//
+// Clock defaults to steady_clock. A fake clock for tests provides now() and, since waiting on a
+// condition variable only understands real time, a static
+// waitUntil(std::condition_variable &, std::unique_lock<std::mutex> &, time_point) that returns once
+// its time reached the deadline or the condition was notified.
+template<class Clock = std::chrono::steady_clock>
+class SteadyIntervalRunner {
+public:
+    using Duration = typename Clock::duration;
+    using TimePoint = typename Clock::time_point;
+
+    // CATCH_UP runs once for every missed grid point, back to back,
+    // SKIP drops them and waits for the next grid point,
+    // COALESCE runs once right away for all of them, then continues on the grid.
+    enum class MissedTicks {
+        CATCH_UP, SKIP, COALESCE
+    };
+
+    // Lateness is how long after its planned start (grid point plus jitter) a run actually started.
+    struct Stats {
+        size_t runs = 0;
+        size_t missed = 0;
+        Duration lastDuration = {};
+        Duration maxDuration = {};
+        Duration totalDuration = {};
+        Duration lastLateness = {};
+        Duration maxLateness = {};
+        Duration totalLateness = {};
+
+        Duration meanDuration() const {
+            return runs == 0 ? Duration::zero() : totalDuration / static_cast<typename Duration::rep>(runs);
+        }
+
+        Duration meanLateness() const {
+            return runs == 0 ? Duration::zero() : totalLateness / static_cast<typename Duration::rep>(runs);
+        }
+    };
+
+    SteadyIntervalRunner(std::function<void()> toRun, const Duration &runEvery, const Duration &firstDelay,
+                         const MissedTicks &missedTicks = MissedTicks::SKIP, const bool &singleRun = false,
+                         const Duration &jitter = Duration::zero())
+            : toRun(std::move(toRun)), runEvery(std::max(runEvery, Duration(1))), firstDelay(firstDelay),
+              jitter(std::clamp(jitter, Duration::zero(), this->runEvery)), missedTicks(missedTicks),
+              singleRun(singleRun) {}
+
+    ~SteadyIntervalRunner() {
+        Stop();
+        Join();
+    }
+
+    SteadyIntervalRunner(const SteadyIntervalRunner &) = delete;
+
+    SteadyIntervalRunner &operator=(const SteadyIntervalRunner &) = delete;
+
+    // Restarts a runner that was stopped, waiting for its previous loop to exit first. Called from
+    // toRun after Stop(), it keeps the current loop going instead.
+    void Run() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (running && (!stopping || mainThread->get_id() == std::this_thread::get_id())) {
+                stopping = false;
+                return;
+            }
+        }
+        Join();
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            running = true;
+            stopping = false;
+        }
+        mainThread = std::make_unique<std::thread>([this] {
+            loop();
+        });
+    }
+
+    // Wakes the runner if it is waiting; a run in progress finishes first.
+    void Stop() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+    }
+
+    void Join() {
+        if (mainThread && mainThread->joinable() && mainThread->get_id() != std::this_thread::get_id()) {
+            mainThread->join();
+        }
+    }
+
+    bool isRunning() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return running;
+    }
+
+    Stats getStats() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return stats;
+    }
+
+private:
+    void loop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        TimePoint gridPoint = Clock::now() + firstDelay;
+        TimePoint deadline = gridPoint + randomDelay();
+        while (waitUntil(lock, deadline)) {
+            const TimePoint start = Clock::now();
+            lock.unlock();
+            try {
+                toRun();
+            } catch (const std::exception &e) {
+                LOG_WARNING << "Interval run failed: " << e.what();
+            }
+            const TimePoint end = Clock::now();
+            lock.lock();
+            record(start - deadline, end - start);
+            if (singleRun) {
+                break;
+            }
+            gridPoint = next(gridPoint, end);
+            deadline = gridPoint + randomDelay();
+        }
+        running = false;
+    }
+
+    Duration randomDelay() {
+        if (jitter == Duration::zero()) {
+            return Duration::zero();
+        }
+        std::uniform_int_distribution<typename Duration::rep> distribution(0, jitter.count());
+        return Duration(distribution(random));
+    }
+
+    // False once stopped.
+    bool waitUntil(std::unique_lock<std::mutex> &lock, const TimePoint &deadline) {
+        while (!stopping && Clock::now() < deadline) {
+            if constexpr (requires { Clock::waitUntil(condition, lock, deadline); }) {
+                Clock::waitUntil(condition, lock, deadline);
+            } else {
+                condition.wait_until(lock, deadline);
+            }
+        }
+        return !stopping;
+    }
+
+    TimePoint next(const TimePoint &deadline, const TimePoint &now) {
+        const TimePoint following = deadline + runEvery;
+        if (following > now) {
+            return following;
+        }
+        const auto behind = static_cast<size_t>((now - following) / runEvery) + 1;
+        switch (missedTicks) {
+            case MissedTicks::CATCH_UP:
+                return following;
+            case MissedTicks::SKIP:
+                stats.missed += behind;
+                return following + runEvery * static_cast<typename Duration::rep>(behind);
+            case MissedTicks::COALESCE:
+            default:
+                stats.missed += behind - 1;
+                return following + runEvery * static_cast<typename Duration::rep>(behind - 1);
+        }
+    }
+
+    void record(const Duration &lateness, const Duration &duration) {
+        ++stats.runs;
+        stats.lastDuration = duration;
+        stats.maxDuration = std::max(stats.maxDuration, duration);
+        stats.totalDuration += duration;
+        stats.lastLateness = lateness;
+        stats.maxLateness = std::max(stats.maxLateness, lateness);
+        stats.totalLateness += lateness;
+    }
+
+    std::function<void()> toRun;
+    const Duration runEvery;
+    const Duration firstDelay;
+    const Duration jitter;
+    const MissedTicks missedTicks;
+    const bool singleRun;
+    bool running = false;
+    bool stopping = false;
+    Stats stats;
+    std::minstd_rand random{std::random_device{}()};
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::unique_ptr<std::thread> mainThread;
+};
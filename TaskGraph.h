@@ -0,0 +1,313 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include "InlineTask.h"
+#include "WorkerPool.h"
+
+// Futures with continuations for WorkerPool. A finished task runs its registered callbacks on the
+// thread that completed it; those callbacks only enqueue dependents on the pool, so fan-out/fan-in
+// graphs never park a worker waiting on another task.
+namespace TaskGraph {
+    template<class T>
+    using Stored = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    template<class T>
+    class SharedState {
+    public:
+        void setValue(Stored<T> result) {
+            complete([&] {
+                value.emplace(std::move(result));
+            });
+        }
+
+        void setError(std::exception_ptr exception) {
+            complete([&] {
+                error = std::move(exception);
+            });
+        }
+
+        // Runs the callback right away if the state is already complete.
+        void onReady(InlineTask callback) {
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (!ready) {
+                    continuations.emplace_back(std::move(callback));
+                    return;
+                }
+            }
+            callback();
+        }
+
+        void wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [&] {
+                return ready.load();
+            });
+        }
+
+        bool isReady() const {
+            return ready;
+        }
+
+        bool failed() const {
+            return error != nullptr;
+        }
+
+        std::exception_ptr getError() const {
+            return error;
+        }
+
+        const Stored<T> &getValue() const {
+            if (error != nullptr) {
+                std::rethrow_exception(error);
+            }
+            return *value;
+        }
+
+    private:
+        template<class Store>
+        void complete(Store store) {
+            std::vector<InlineTask> callbacks;
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                if (ready) {
+                    return;
+                }
+                store();
+                ready = true;
+                callbacks.swap(continuations);
+            }
+            condition.notify_all();
+            for (auto &callback: callbacks) {
+                callback();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::atomic_bool ready = {false};
+        std::optional<Stored<T>> value;
+        std::exception_ptr error;
+        std::vector<InlineTask> continuations;
+    };
+
+    template<class Result, class Function, class... Args>
+    void fulfil(SharedState<Result> &state, Function &function, Args &&... args) {
+        try {
+            if constexpr (std::is_void_v<Result>) {
+                function(std::forward<Args>(args)...);
+                state.setValue({});
+            } else {
+                state.setValue(function(std::forward<Args>(args)...));
+            }
+        } catch (...) {
+            state.setError(std::current_exception());
+        }
+    }
+
+    // Held by a scheduled task until it runs. A pool that destroys the task without running it
+    // (rejected, DROP_OLDEST, cancelQueued(), stop(), an expired deadline) thereby fails the state
+    // instead of leaving it and every continuation pending.
+    template<class Result>
+    class PendingState {
+    public:
+        explicit PendingState(std::shared_ptr<SharedState<Result>> state) : state(std::move(state)) {}
+
+        PendingState(PendingState &&) noexcept = default;
+
+        PendingState &operator=(PendingState &&) = delete;
+
+        ~PendingState() {
+            if (state != nullptr) {
+                state->setError(std::make_exception_ptr(std::runtime_error("Task was dropped by the pool")));
+            }
+        }
+
+        std::shared_ptr<SharedState<Result>> take() {
+            return std::move(state);
+        }
+
+    private:
+        std::shared_ptr<SharedState<Result>> state;
+    };
+
+    // Runs the task on the pool, or inline when there is none. A rejected task is destroyed unrun,
+    // which fails its PendingState.
+    inline void schedule(WorkerPool *pool, InlineTask task) {
+        if (pool == nullptr) {
+            task();
+            return;
+        }
+        if (pool->addTask(std::move(task)) != SubmitResult::REJECTED) {
+            pool->start();
+        }
+    }
+}
+
+template<class T>
+class TaskFuture {
+public:
+    TaskFuture() = default;
+
+    TaskFuture(std::shared_ptr<TaskGraph::SharedState<T>> state, WorkerPool *pool) : state(std::move(state)),
+                                                                                     pool(pool) {}
+
+    bool valid() const {
+        return state != nullptr;
+    }
+
+    bool isReady() const {
+        return state->isReady();
+    }
+
+    // Blocks the calling thread; use then/whenAll/whenAny from inside pool tasks instead.
+    void wait() const {
+        state->wait();
+    }
+
+    decltype(auto) get() const {
+        state->wait();
+        if constexpr (std::is_void_v<T>) {
+            state->getValue();
+        } else {
+            return state->getValue();
+        }
+    }
+
+    // Schedules function on the pool once this future is ready. It receives the value (nothing for
+    // void) and an exception is passed on to the returned future without calling function.
+    template<class Function>
+    auto then(Function &&function) const {
+        using Result = typename ContinuationResult<std::decay_t<Function>>::type;
+        auto next = std::make_shared<TaskGraph::SharedState<Result>>();
+        state->onReady([previous = state, next, pool = pool,
+                               function = std::forward<Function>(function)]() mutable {
+            if (previous->failed()) {
+                next->setError(previous->getError());
+                return;
+            }
+            TaskGraph::schedule(pool, [previous, pending = TaskGraph::PendingState<Result>(next),
+                                              function = std::move(function)]() mutable {
+                const auto result = pending.take();
+                if constexpr (std::is_void_v<T>) {
+                    TaskGraph::fulfil(*result, function);
+                } else {
+                    TaskGraph::fulfil(*result, function, previous->getValue());
+                }
+            });
+        });
+        return TaskFuture<Result>(next, pool);
+    }
+
+    void onReady(InlineTask callback) const {
+        state->onReady(std::move(callback));
+    }
+
+    const std::shared_ptr<TaskGraph::SharedState<T>> &getState() const {
+        return state;
+    }
+
+    WorkerPool *getPool() const {
+        return pool;
+    }
+
+private:
+    template<class Function, bool = std::is_void_v<T>>
+    struct ContinuationResult {
+        using type = std::invoke_result_t<Function &>;
+    };
+
+    template<class Function>
+    struct ContinuationResult<Function, false> {
+        using type = std::invoke_result_t<Function &, const T &>;
+    };
+
+    std::shared_ptr<TaskGraph::SharedState<T>> state;
+    WorkerPool *pool = nullptr;
+};
+
+namespace TaskGraph {
+    template<class Function>
+    auto submit(WorkerPool &pool, Function &&function) {
+        using Result = std::invoke_result_t<std::decay_t<Function> &>;
+        auto state = std::make_shared<SharedState<Result>>();
+        schedule(&pool, [pending = PendingState<Result>(state),
+                                function = std::forward<Function>(function)]() mutable {
+            fulfil(*pending.take(), function);
+        });
+        return TaskFuture<Result>(state, &pool);
+    }
+
+    template<class T>
+    TaskFuture<T> makeReady(WorkerPool *pool, Stored<T> value) {
+        auto state = std::make_shared<SharedState<T>>();
+        state->setValue(std::move(value));
+        return TaskFuture<T>(state, pool);
+    }
+
+    // Completes once every input is ready, with the values in input order (or nothing for void).
+    // The first failed input, in input order, becomes the error of the result.
+    template<class T>
+    auto whenAll(const std::vector<TaskFuture<T>> &futures) {
+        using Result = std::conditional_t<std::is_void_v<T>, void, std::vector<Stored<T>>>;
+        WorkerPool *pool = futures.empty() ? nullptr : futures.front().getPool();
+        auto result = std::make_shared<SharedState<Result>>();
+        if (futures.empty()) {
+            result->setValue({});
+            return TaskFuture<Result>(result, pool);
+        }
+        auto remaining = std::make_shared<std::atomic_size_t>(futures.size());
+        auto inputs = std::make_shared<std::vector<TaskFuture<T>>>(futures);
+        for (const auto &future: futures) {
+            future.onReady([result, remaining, inputs] {
+                if (--(*remaining) != 0) {
+                    return;
+                }
+                for (const auto &input: *inputs) {
+                    if (input.getState()->failed()) {
+                        result->setError(input.getState()->getError());
+                        return;
+                    }
+                }
+                if constexpr (std::is_void_v<T>) {
+                    result->setValue({});
+                } else {
+                    std::vector<T> values;
+                    values.reserve(inputs->size());
+                    for (const auto &input: *inputs) {
+                        values.emplace_back(input.getState()->getValue());
+                    }
+                    result->setValue(std::move(values));
+                }
+            });
+        }
+        return TaskFuture<Result>(result, pool);
+    }
+
+    // Completes with the index of the first input that became ready, successfully or not. Without
+    // inputs it fails at once with std::invalid_argument.
+    template<class T>
+    TaskFuture<size_t> whenAny(const std::vector<TaskFuture<T>> &futures) {
+        WorkerPool *pool = futures.empty() ? nullptr : futures.front().getPool();
+        auto result = std::make_shared<SharedState<size_t>>();
+        if (futures.empty()) {
+            result->setError(std::make_exception_ptr(std::invalid_argument("whenAny needs at least one future")));
+            return TaskFuture<size_t>(result, pool);
+        }
+        for (size_t i = 0; i < futures.size(); ++i) {
+            futures[i].onReady([result, i] {
+                result->setValue(i);
+            });
+        }
+        return TaskFuture<size_t>(result, pool);
+    }
+}
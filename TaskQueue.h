@@ -0,0 +1,68 @@
+#pragma once
+
+#include <mutex>
+#include <queue>
+#include <memory>
+#include "MPMCQueue.h"
+
+enum class TaskStore {
+    LOCKED_QUEUE, LOCK_FREE_RING
+};
+
+// Task store shared by the worker pools. LOCKED_QUEUE is the original unbounded std::queue behind a
+// mutex, LOCK_FREE_RING is a bounded MPMCQueue where tryPush fails once capacity is reached.
+template<class T>
+class TaskQueue {
+public:
+    explicit TaskQueue(const TaskStore &store = TaskStore::LOCKED_QUEUE, const size_t &capacity = 4096)
+            : store(store) {
+        if (store == TaskStore::LOCK_FREE_RING) {
+            ring = std::make_unique<MPMCQueue<T>>(capacity);
+        }
+    }
+
+    template<class U>
+    bool tryPush(U &&task) {
+        if (ring) {
+            return ring->tryPush(std::forward<U>(task));
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        tasks.emplace(std::forward<U>(task));
+        return true;
+    }
+
+    bool tryPop(T &task) {
+        if (ring) {
+            return ring->tryPop(task);
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        if (tasks.empty()) {
+            return false;
+        }
+        task = std::move(tasks.front());
+        tasks.pop();
+        return true;
+    }
+
+    size_t size() const {
+        if (ring) {
+            return ring->size();
+        }
+        std::lock_guard<std::mutex> guard(mutex);
+        return tasks.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    TaskStore getStore() const {
+        return store;
+    }
+
+private:
+    const TaskStore store;
+    std::unique_ptr<MPMCQueue<T>> ring;
+    mutable std::mutex mutex;
+    std::queue<T> tasks;
+};
@@ -3,11 +3,15 @@
 #include <thread>
 #include <vector>
 #include <functional>
-#include "MultiSemaphore.h"
+#include "CompletionLatch.h"
 #include "Semaphore.h"
 #include <queue>
 #include <atomic>
 #include "FlowLog.h"
+#include "InlineTask.h"
+#include "PoolMetrics.h"
+#include "AdmissionControl.h"
+#include "FlowTask.h"
 #include <memory>
 
 class ThreadPool {
@@ -17,13 +21,49 @@ public:
         this->threadLimit = threadLimit;
     }
 
-    void addFunction(std::shared_ptr<std::function<void()>> function) {
-        std::lock_guard guard(functionsMutex);
-        toWaitFor.addLock();
-        functions.emplace(function);
+    SubmitResult addFunction(std::shared_ptr<std::function<void()>> function) {
+        return addFunction(InlineTask([function] {
+            (*function)();
+        }));
+    }
+
+    // Applies the admission policy once the queue is full, see setAdmission.
+    SubmitResult addFunction(InlineTask function) {
+        return submit(std::move(function), true);
+    }
+
+    // Never blocks or runs the function on the caller: a full queue rejects it whatever the policy.
+    SubmitResult trySubmit(InlineTask function) {
+        return submit(std::move(function), false);
+    }
+
+    // co_await pool.schedule() continues the coroutine on one of the pool's threads.
+    auto schedule() {
+        return FlowCoroutine::ScheduleAwaiter([this](InlineTask function) {
+            const SubmitResult result = addFunction(std::move(function));
+            start();
+            return result;
+        });
+    }
+
+    // Caps the number of queued functions (0 means unbounded, the default) and picks what addFunction
+    // does once the cap is reached.
+    void setAdmission(const size_t &capacity, const AdmissionPolicy &policy = AdmissionPolicy::BLOCK) {
+        admission.setLimit(capacity, policy);
+    }
+
+    size_t getHighWaterMark() const {
+        return admission.getHighWaterMark();
+    }
+
+    size_t getRejectedCount() const {
+        return admission.getRejectedCount();
     }
 
     void start() {
+#ifdef FLOW_POOL_METRICS
+        metrics.setWorkers(threadLimit);
+#endif
         std::unique_lock<std::mutex>lock(poolMutex, std::try_to_lock);
         if (lock.owns_lock()) {
             startThreads();
@@ -39,33 +79,110 @@ public:
 
     size_t threadLimit;
 
+#ifdef FLOW_POOL_METRICS
+    PoolMetricsSnapshot getMetrics() const {
+        return metrics.snapshot();
+    }
+#endif
+
 private:
+    SubmitResult submit(InlineTask function, const bool &mayBlock) {
+#ifdef FLOW_POOL_METRICS
+        const uint64_t queuedAt = metrics.taskQueued();
+#endif
+        const size_t capacity = admission.getCapacity();
+        if (capacity != 0 && admission.size() >= capacity) {
+            start();
+        }
+        const SubmitResult result = admission.admit(mayBlock, [&] {
+            std::lock_guard guard(functionsMutex);
+            toWaitFor.addLock();
+            functions.emplace(std::move(function));
+#ifdef FLOW_POOL_METRICS
+            queuedTimes.push(queuedAt);
+#endif
+        }, [&] {
+            InlineTask oldest;
+            {
+                std::lock_guard guard(functionsMutex);
+                if (functions.empty()) {
+                    return false;
+                }
+                oldest = std::move(functions.front());
+                functions.pop();
+#ifdef FLOW_POOL_METRICS
+                queuedTimes.pop();
+#endif
+            }
+            admission.release();
+            toWaitFor.unlock();
+#ifdef FLOW_POOL_METRICS
+            metrics.taskDiscarded();
+#endif
+            return true;
+        }, [&] {
+#ifdef FLOW_POOL_METRICS
+            metrics.run(queuedAt, function);
+#else
+            function();
+#endif
+        });
+#ifdef FLOW_POOL_METRICS
+        if (result == SubmitResult::REJECTED) {
+            metrics.taskDiscarded();
+        }
+#endif
+        return result;
+    }
+
     void startThreads() {
         while (runningThreads < threadLimit && !functions.empty()) {
             try {
                 std::lock_guard guard(functionsMutex);
-                auto toRun = functions.front();
-                std::thread([&, toRun] {
+                if (functions.empty()) {
+                    break;
+                }
+                auto toRun = std::move(functions.front());
+                uint64_t queuedAt = 0;
+#ifdef FLOW_POOL_METRICS
+                queuedAt = queuedTimes.front();
+                queuedTimes.pop();
+#endif
+                std::thread([&, toRun = std::move(toRun), queuedAt]() mutable {
                     ++runningThreads;
-                    (*toRun)();
+#ifdef FLOW_POOL_METRICS
+                    metrics.run(queuedAt, toRun);
+#else
+                    toRun();
+#endif
                     --runningThreads;
                     start();
                     toWaitFor.unlock();
                 }).detach();
                 functions.pop();
+                admission.release();
             } catch (const std::system_error &e) {
                 std::cout << "Code " << e.code()
                             << " meaning " << e.what() << '\n';
                 functions.pop();
+                admission.release();
                 --runningThreads;
             }
         }
     }
 
-    std::queue<std::shared_ptr<std::function<void()>>> functions;
+    std::queue<InlineTask> functions;
+#ifdef FLOW_POOL_METRICS
+    // PoolMetrics::taskQueued() stamps in step with functions.
+    std::queue<uint64_t> queuedTimes;
+#endif
+    AdmissionControl admission;
 
     std::atomic_size_t runningThreads = {0};
-    MultiSemaphore toWaitFor;
+    PendingTasks toWaitFor;
     std::mutex poolMutex;
     std::mutex functionsMutex;
+#ifdef FLOW_POOL_METRICS
+    PoolMetrics metrics;
+#endif
 };
@@ -0,0 +1,439 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+#include "FlowLog.h"
+#include "InlineTask.h"
+
+// Runs one-shot and periodic timers from a single thread. Timers hang in a hierarchical wheel of four
+// levels with 256 slots each, level n counting 256^n ticks per slot, and move down a level whenever
+// the level below wraps, so schedule, cancel and reschedule are O(1) whatever the number of timers.
+// The thread only wakes for the next occupied slot (or the next cascade) and immediately on stop().
+//
+// Expired timers run on the wheel thread unless a dispatch function is given, e.g. one that hands
+// them to a pool; the pool has to finish those tasks before the wheel is destroyed. A timer never
+// overlaps itself: a dispatched FIXED_RATE run still going when the timer is due again makes the wheel
+// skip the grid points it covers, as SteadyIntervalRunner's SKIP does.
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+    using TimerId = uint64_t;
+    using Dispatch = std::function<void(InlineTask)>;
+
+    // FIXED_RATE keeps runs on the grid firstDelay + n * period (IntervalRunner without alwaysWait),
+    // FIXED_DELAY waits period after each run finished (IntervalRunner with alwaysWait).
+    enum class Mode {
+        FIXED_RATE, FIXED_DELAY
+    };
+
+    // How late the runs of a timer started compared to when they were due, and how many FIXED_RATE runs
+    // were skipped because the previous one was still going.
+    struct DriftStats {
+        size_t runs = 0;
+        size_t skipped = 0;
+        Clock::duration last = {};
+        Clock::duration max = {};
+        Clock::duration total = {};
+
+        Clock::duration mean() const {
+            return runs == 0 ? Clock::duration::zero() : total / static_cast<Clock::rep>(runs);
+        }
+    };
+
+    explicit TimerWheel(const Clock::duration &tick = std::chrono::milliseconds(1), Dispatch dispatch = {})
+            : tick(tick <= Clock::duration::zero() ? Clock::duration(1) : tick), dispatch(std::move(dispatch)),
+              start(Clock::now()) {
+        for (auto &level: slots) {
+            level.fill(NONE);
+        }
+        thread = std::thread([this] {
+            run();
+        });
+    }
+
+    ~TimerWheel() {
+        stop();
+        // Still joinable only when one of its own timers destroys the wheel: the thread cannot join
+        // itself, so it is detached and leaves run() without touching the wheel again.
+        if (thread.joinable()) {
+            destroyedOnThisThread() = this;
+            thread.detach();
+        }
+    }
+
+    TimerWheel(const TimerWheel &) = delete;
+
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    // Runs task after firstDelay, then every period unless period is zero.
+    TimerId schedule(std::function<void()> task, const Clock::duration &firstDelay,
+                     const Clock::duration &period = Clock::duration::zero(), const Mode &mode = Mode::FIXED_RATE) {
+        std::lock_guard<std::mutex> guard(mutex);
+        uint32_t index;
+        if (freeTimers.empty()) {
+            index = static_cast<uint32_t>(timers.size());
+            timers.emplace_back();
+        } else {
+            index = freeTimers.back();
+            freeTimers.pop_back();
+        }
+        Timer &timer = timers[index];
+        timer.task = std::make_shared<std::function<void()>>(std::move(task));
+        timer.period = period;
+        timer.mode = mode;
+        timer.drift = {};
+        timer.running = false;
+        timer.live = true;
+        ++live;
+        arm(index, Clock::now() + firstDelay);
+        return idOf(index);
+    }
+
+    // False when the timer already finished or was cancelled. A run in progress is not interrupted.
+    bool cancel(const TimerId &id) {
+        std::lock_guard<std::mutex> guard(mutex);
+        const auto index = find(id);
+        if (!index) {
+            return false;
+        }
+        release(*index);
+        return true;
+    }
+
+    // Moves the next run to delay from now; a periodic timer continues from there.
+    bool reschedule(const TimerId &id, const Clock::duration &delay) {
+        std::lock_guard<std::mutex> guard(mutex);
+        const auto index = find(id);
+        if (!index) {
+            return false;
+        }
+        unlink(*index);
+        arm(*index, Clock::now() + delay);
+        return true;
+    }
+
+    std::optional<DriftStats> getDrift(const TimerId &id) const {
+        std::lock_guard<std::mutex> guard(mutex);
+        const auto index = find(id);
+        if (!index) {
+            return std::nullopt;
+        }
+        return timers[*index].drift;
+    }
+
+    // Timers scheduled and neither finished nor cancelled.
+    size_t size() const {
+        std::lock_guard<std::mutex> guard(mutex);
+        return live;
+    }
+
+    // Wakes the thread at once and joins it; pending timers never run. Called from a timer, which runs
+    // on the wheel thread, it only stops the wheel and the destructor joins the thread.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        if (thread.joinable() && thread.get_id() != std::this_thread::get_id()) {
+            thread.join();
+        }
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+    static constexpr size_t levels = 4;
+    static constexpr uint64_t slotBits = 8;
+    static constexpr uint64_t slotMask = (1u << slotBits) - 1;
+
+    struct Timer {
+        std::shared_ptr<std::function<void()>> task;
+        Clock::time_point due;
+        Clock::duration period = {};
+        Mode mode = Mode::FIXED_RATE;
+        uint64_t expiry = 0;
+        uint32_t generation = 0;
+        uint32_t previous = NONE;
+        uint32_t next = NONE;
+        uint8_t level = 0;
+        uint8_t slot = 0;
+        bool armed = false;
+        bool live = false;
+        // A dispatched FIXED_RATE run has not finished yet.
+        bool running = false;
+        DriftStats drift;
+    };
+
+    struct Expired {
+        uint32_t index;
+        TimerId id;
+        std::shared_ptr<std::function<void()>> task;
+        bool notifyWhenDone;
+    };
+
+    TimerId idOf(const uint32_t &index) const {
+        return static_cast<TimerId>(timers[index].generation) << 32 | index;
+    }
+
+    std::optional<uint32_t> find(const TimerId &id) const {
+        const auto index = static_cast<uint32_t>(id);
+        if (index >= timers.size() || !timers[index].live || timers[index].generation != id >> 32) {
+            return std::nullopt;
+        }
+        return index;
+    }
+
+    // The first tick at or after time.
+    uint64_t tickOf(const Clock::time_point &time) const {
+        if (time <= start) {
+            return 0;
+        }
+        return static_cast<uint64_t>((time - start + tick - Clock::duration(1)) / tick);
+    }
+
+    // The last tick that has begun.
+    uint64_t currentTick(const Clock::time_point &now) const {
+        return static_cast<uint64_t>((now - start) / tick);
+    }
+
+    void arm(const uint32_t &index, const Clock::time_point &due) {
+        // An empty wheel has no slot to visit, so it skips the ticks it idled through at once.
+        if (armedTimers == 0) {
+            processed = std::max(processed, currentTick(Clock::now()));
+        }
+        Timer &timer = timers[index];
+        timer.due = due;
+        timer.expiry = std::max(tickOf(due), processed + 1);
+        link(index);
+        if (timer.expiry < wakeTick) {
+            condition.notify_one();
+        }
+    }
+
+    // Picks the level by distance, the slot by the expiry's own bits at that level, as in the classic
+    // cascading wheel; timers beyond the top level wait in its farthest slot and are placed again.
+    void link(const uint32_t &index) {
+        Timer &timer = timers[index];
+        const uint64_t distance = timer.expiry - processed;
+        uint64_t expiry = timer.expiry;
+        size_t level = 0;
+        while (level + 1 < levels && distance >= uint64_t(1) << (slotBits * (level + 1))) {
+            ++level;
+        }
+        if (distance >= uint64_t(1) << (slotBits * levels)) {
+            expiry = processed + (uint64_t(1) << (slotBits * levels)) - 1;
+        }
+        timer.level = static_cast<uint8_t>(level);
+        timer.slot = static_cast<uint8_t>((expiry >> (slotBits * level)) & slotMask);
+        uint32_t &head = slots[level][timer.slot];
+        timer.previous = NONE;
+        timer.next = head;
+        if (head != NONE) {
+            timers[head].previous = index;
+        }
+        head = index;
+        timer.armed = true;
+        ++armedTimers;
+    }
+
+    void unlink(const uint32_t &index) {
+        Timer &timer = timers[index];
+        if (!timer.armed) {
+            return;
+        }
+        if (timer.previous != NONE) {
+            timers[timer.previous].next = timer.next;
+        } else {
+            slots[timer.level][timer.slot] = timer.next;
+        }
+        if (timer.next != NONE) {
+            timers[timer.next].previous = timer.previous;
+        }
+        timer.armed = false;
+        --armedTimers;
+    }
+
+    void release(const uint32_t &index) {
+        Timer &timer = timers[index];
+        unlink(index);
+        timer.task.reset();
+        timer.live = false;
+        ++timer.generation;
+        freeTimers.push_back(index);
+        --live;
+    }
+
+    // Advances to tick: cascades the levels that wrapped, then collects the level 0 slot. Cascaded
+    // timers are placed relative to tick itself, so those due in it land in the slot collected next.
+    void advance(const uint64_t &tickToProcess, const Clock::time_point &now, std::vector<Expired> &expired) {
+        processed = tickToProcess;
+        for (size_t level = levels - 1; level > 0; --level) {
+            if ((tickToProcess & ((uint64_t(1) << (slotBits * level)) - 1)) != 0) {
+                continue;
+            }
+            uint32_t &head = slots[level][(tickToProcess >> (slotBits * level)) & slotMask];
+            uint32_t index = std::exchange(head, NONE);
+            while (index != NONE) {
+                const uint32_t next = timers[index].next;
+                timers[index].armed = false;
+                --armedTimers;
+                link(index);
+                index = next;
+            }
+        }
+        uint32_t index = std::exchange(slots[0][tickToProcess & slotMask], NONE);
+        while (index != NONE) {
+            Timer &timer = timers[index];
+            const uint32_t next = timer.next;
+            timer.armed = false;
+            --armedTimers;
+            if (timer.running) {
+                const auto missed = (now - timer.due) / timer.period + 1;
+                timer.drift.skipped += static_cast<size_t>(missed);
+                arm(index, timer.due + timer.period * missed);
+                index = next;
+                continue;
+            }
+            const auto late = std::max(Clock::duration::zero(), now - timer.due);
+            ++timer.drift.runs;
+            timer.drift.last = late;
+            timer.drift.max = std::max(timer.drift.max, late);
+            timer.drift.total += late;
+            const bool periodic = timer.period > Clock::duration::zero();
+            const bool fixedRate = periodic && timer.mode == Mode::FIXED_RATE;
+            timer.running = fixedRate && dispatch;
+            expired.push_back({index, idOf(index), timer.task, periodic && (!fixedRate || timer.running)});
+            if (!periodic) {
+                release(index);
+            } else if (fixedRate) {
+                arm(index, std::max(timer.due + timer.period, now));
+            }
+            index = next;
+        }
+    }
+
+    // Called once a periodic run finished: lets a dispatched FIXED_RATE timer run again and arms a
+    // FIXED_DELAY one, unless the timer was cancelled or rescheduled meanwhile.
+    void finished(const TimerId &id) {
+        std::lock_guard<std::mutex> guard(mutex);
+        const auto index = find(id);
+        if (!index) {
+            return;
+        }
+        Timer &timer = timers[*index];
+        if (timer.mode == Mode::FIXED_RATE) {
+            timer.running = false;
+            return;
+        }
+        if (timer.armed || stopping) {
+            return;
+        }
+        arm(*index, Clock::now() + timer.period);
+    }
+
+    // False once the task destroyed the wheel.
+    bool execute(Expired &entry) {
+        if (dispatch) {
+            dispatch(InlineTask([this, task = std::move(entry.task), id = entry.id,
+                                        notifyWhenDone = entry.notifyWhenDone] {
+                runTask(*task);
+                if (notifyWhenDone) {
+                    finished(id);
+                }
+            }));
+            return true;
+        }
+        runTask(*entry.task);
+        if (destroyedOnThisThread() == this) {
+            return false;
+        }
+        if (entry.notifyWhenDone) {
+            finished(entry.id);
+        }
+        return true;
+    }
+
+    static TimerWheel *&destroyedOnThisThread() {
+        static thread_local TimerWheel *wheel = nullptr;
+        return wheel;
+    }
+
+    static void runTask(const std::function<void()> &task) {
+        try {
+            task();
+        } catch (const std::exception &e) {
+            LOG_WARNING << "Timer failed: " << e.what();
+        }
+    }
+
+    // The next occupied level 0 slot before the next cascade, else the cascade itself.
+    uint64_t nextWake() const {
+        const uint64_t boundary = (processed | slotMask) + 1;
+        for (uint64_t candidate = processed + 1; candidate < boundary; ++candidate) {
+            if (slots[0][candidate & slotMask] != NONE) {
+                return candidate;
+            }
+        }
+        return boundary;
+    }
+
+    void run() {
+        std::vector<Expired> expired;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            const auto now = Clock::now();
+            const uint64_t target = currentTick(now);
+            if (armedTimers == 0) {
+                processed = std::max(processed, target);
+            }
+            // Ticks without an occupied slot or a cascade change nothing, so catching up jumps over them.
+            while (processed < target && expired.empty()) {
+                advance(std::min(nextWake(), target), now, expired);
+            }
+            if (!expired.empty()) {
+                lock.unlock();
+                for (auto &entry: expired) {
+                    if (!execute(entry)) {
+                        return;
+                    }
+                }
+                expired.clear();
+                lock.lock();
+                continue;
+            }
+            if (live == 0) {
+                wakeTick = UINT64_MAX;
+                condition.wait(lock);
+            } else {
+                wakeTick = nextWake();
+                condition.wait_until(lock, start + tick * static_cast<Clock::rep>(wakeTick));
+            }
+            wakeTick = 0;
+        }
+    }
+
+    const Clock::duration tick;
+    const Dispatch dispatch;
+    const Clock::time_point start;
+    std::array<std::array<uint32_t, slotMask + 1>, levels> slots{};
+    std::vector<Timer> timers;
+    std::vector<uint32_t> freeTimers;
+    size_t live = 0;
+    size_t armedTimers = 0;
+    uint64_t processed = 0;
+    // The tick the thread sleeps until; 0 while it is awake and will look at the wheel anyway.
+    uint64_t wakeTick = 0;
+    bool stopping = false;
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::thread thread;
+};
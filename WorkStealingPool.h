@@ -0,0 +1,221 @@
+#pragma once
+
+#include <thread>
+#include <vector>
+#include <deque>
+#include <tuple>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include "FlowLog.h"
+#include "InlineTask.h"
+#include "FlowTask.h"
+
+// Persistent executor with one deque per worker thread. Workers pop their own deque LIFO and steal
+// FIFO from the others when it runs dry. addFunction/start/join mirror ThreadPool so existing
+// callers can switch the type without touching call sites.
+class WorkStealingPool {
+public:
+
+    WorkStealingPool(const size_t &threadLimit = std::thread::hardware_concurrency())
+            : threadLimit(threadLimit == 0 ? 1 : threadLimit), queues(this->threadLimit) {
+        threads.reserve(this->threadLimit);
+        for (size_t i = 0; i < this->threadLimit; ++i) {
+            threads.emplace_back([this, i] {
+                workerThread(i);
+            });
+        }
+    }
+
+    ~WorkStealingPool() {
+        stop();
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    template<class Function, class... Args>
+    auto submit(Function &&function, Args &&... args) {
+        using Result = std::invoke_result_t<std::decay_t<Function>, std::decay_t<Args>...>;
+        std::packaged_task<Result()> task(
+                [function = std::forward<Function>(function),
+                        arguments = std::make_tuple(std::forward<Args>(args)...)]() mutable {
+                    return std::apply(function, std::move(arguments));
+                });
+        auto future = task.get_future();
+        push([task = std::move(task)]() mutable {
+            task();
+        });
+        return future;
+    }
+
+    void addFunction(std::shared_ptr<std::function<void()>> function) {
+        push([function] {
+            (*function)();
+        });
+    }
+
+    void addFunction(InlineTask function) {
+        push(std::move(function));
+    }
+
+    // co_await pool.schedule() continues the coroutine on a worker; from a worker of this pool it
+    // lands on that worker's own deque, where idle workers can steal it.
+    auto schedule() {
+        return FlowCoroutine::ScheduleAwaiter([this](InlineTask function) {
+            push(std::move(function));
+        });
+    }
+
+    // Tasks are picked up as soon as they are added, start() only exists for ThreadPool compatibility.
+    void start() {
+    }
+
+    // Blocks until every submitted task has finished. Must not be called from a worker of this pool.
+    void join() {
+        std::unique_lock<std::mutex> lock(joinMutex);
+        joinCondition.wait(lock, [&] {
+            return pending == 0;
+        });
+    }
+
+    // Finishes the queued tasks and joins the worker threads.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(sleepMutex);
+            isStopping = true;
+        }
+        sleepCondition.notify_all();
+        for (auto &thread: threads) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+
+    size_t size() const {
+        return pending;
+    }
+
+    // Runs one queued task on the calling thread, so a thread waiting on other tasks of this pool
+    // (also one of its workers) helps instead of blocking. Returns false when nothing was queued.
+    bool runPendingTask() {
+        const size_t index = currentPool == this ? currentIndex : 0;
+        InlineTask task;
+        if (!pop(index, task) && !steal(index, task)) {
+            return false;
+        }
+        run(task);
+        return true;
+    }
+
+    const size_t threadLimit;
+
+private:
+    struct alignas(64) WorkQueue {
+        std::mutex mutex;
+        std::deque<InlineTask> tasks;
+    };
+
+    void push(InlineTask task) {
+        ++pending;
+        ++queued;
+        auto &queue = queues[currentPool == this ? currentIndex : nextQueue++ % threadLimit];
+        {
+            std::lock_guard<std::mutex> guard(queue.mutex);
+            queue.tasks.emplace_back(std::move(task));
+        }
+        if (sleeping > 0) {
+            std::lock_guard<std::mutex> guard(sleepMutex);
+            sleepCondition.notify_one();
+        }
+    }
+
+    bool pop(const size_t index, InlineTask &task) {
+        auto &queue = queues[index];
+        std::lock_guard<std::mutex> guard(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        --queued;
+        return true;
+    }
+
+    bool steal(const size_t index, InlineTask &task) {
+        for (size_t i = 1; i < threadLimit && queued > 0; ++i) {
+            auto &queue = queues[(index + i) % threadLimit];
+            std::lock_guard<std::mutex> guard(queue.mutex);
+            if (queue.tasks.empty()) {
+                continue;
+            }
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            --queued;
+            return true;
+        }
+        return false;
+    }
+
+    void run(InlineTask &task) {
+        try {
+            task();
+        } catch (const std::exception &e) {
+            LOG_WARNING << "Task failed: " << e.what();
+        }
+        task = nullptr;
+        if (--pending == 0) {
+            std::lock_guard<std::mutex> guard(joinMutex);
+            joinCondition.notify_all();
+        }
+    }
+
+    void workerThread(const size_t index) {
+        currentPool = this;
+        currentIndex = index;
+        InlineTask task;
+        while (true) {
+            if (pop(index, task) || steal(index, task)) {
+                run(task);
+                continue;
+            }
+            for (size_t spin = 0; spin < spinCount && queued == 0; ++spin) {
+                std::this_thread::yield();
+            }
+            if (queued > 0) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            ++sleeping;
+            sleepCondition.wait(lock, [&] {
+                return queued > 0 || isStopping;
+            });
+            --sleeping;
+            if (isStopping && queued == 0) {
+                return;
+            }
+        }
+    }
+
+    static constexpr size_t spinCount = 64;
+    static inline thread_local WorkStealingPool *currentPool = nullptr;
+    static inline thread_local size_t currentIndex = 0;
+
+    std::vector<WorkQueue> queues;
+    std::vector<std::thread> threads;
+    std::atomic_size_t nextQueue = {0};
+    std::atomic_size_t queued = {0};
+    std::atomic_size_t pending = {0};
+    std::atomic_size_t sleeping = {0};
+    std::atomic_bool isStopping = {false};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::mutex joinMutex;
+    std::condition_variable joinCondition;
+};
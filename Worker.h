@@ -1,8 +1,15 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <thread>
 #include <functional>
-#include "Semaphore.h"
+#include <utility>
+#include "Parker.h"
+#include "InlineTask.h"
+#include "FlowAffinity.h"
+#include "PoolMetrics.h"
+#include "CancellationToken.h"
 
 enum WorkerState {
     IDLE, RUNNING, STOPPED
@@ -21,21 +28,62 @@ public:
     }
 
     void assignTask(std::shared_ptr<std::function<void()>> task) {
-        currentTask = task;
+        assignTask(InlineTask([task] {
+            (*task)();
+        }));
+    }
+
+    void assignTask(InlineTask task) {
+        currentTask = std::move(task);
+        assigned.store(true, std::memory_order_release);
         runTask();
     }
 
+    // The next task runs with token as CancellationToken::current().
+    void cancelWith(CancellationToken token) {
+        currentToken = std::move(token);
+    }
+
+#ifdef FLOW_POOL_METRICS
+
+    // The next task's wait and run time go to metrics; queuedAt is its PoolMetrics::taskQueued() stamp.
+    void trackNext(PoolMetrics &poolMetrics, const uint64_t &taskQueuedAt) {
+        metrics = &poolMetrics;
+        queuedAt = taskQueuedAt;
+    }
+
+#endif
+
     const size_t getId() {
         return id;
     }
 
+    // Binds the worker thread according to the placement; returns false when it stays unbound.
+    bool pin(const FlowAffinity::Placement &toPin) {
+        placement = toPin;
+        return FlowAffinity::pin(mainThread, placement);
+    }
+
+    // Cpu the worker is pinned to, -1 when it is unbound or bound to a whole node.
+    int getCpu() const {
+        return placement.cpu;
+    }
+
+    // Index into FlowAffinity::Topology::nodes, -1 when the worker is unbound.
+    int getNode() const {
+        return placement.node;
+    }
+
     void stop() {
         state = STOPPED;
-        mainSemaphore.unlock();
+        parker.unpark();
     }
 
+    // A no-op on the worker's own thread, which cannot join itself.
     void join() {
-        mainThread.join();
+        if (mainThread.joinable() && mainThread.get_id() != std::this_thread::get_id()) {
+            mainThread.join();
+        }
     }
 
     void detach() {
@@ -50,32 +98,91 @@ public:
         onStopCallback = callback;
     }
 
-    WorkerState state = IDLE;
+    // Called after a finished task. Returning true with a new task keeps the worker draining without
+    // going idle; returning false makes it idle and parks it until the next assignTask.
+    void onFetch(const std::shared_ptr<std::function<bool(Worker *worker, InlineTask &task)>> &callback) {
+        onFetchCallback = callback;
+    }
+
+    void setSpinWindow(const std::chrono::nanoseconds &window) {
+        parker.setSpinWindow(window);
+    }
+
+    // Called when the worker stayed idle for the idle timeout. Returning true retires it: the thread
+    // exits without firing the stop callback and must still be joined by another thread.
+    void onTimeout(const std::shared_ptr<std::function<bool(Worker *worker)>> &callback) {
+        onTimeoutCallback = callback;
+    }
+
+    // Zero (the default) lets the worker wait for its next task forever.
+    void setIdleTimeout(const std::chrono::nanoseconds &timeout) {
+        idleTimeout = timeout;
+        parker.unpark();
+    }
+
+    std::atomic<WorkerState> state = {IDLE};
 private:
     const std::size_t id;
 
     std::thread workerThread() {
         return std::thread([&] {
             while (state != STOPPED) {
-                mainSemaphore.lock();
-                if(currentTask == nullptr){
+                const std::chrono::nanoseconds timeout = idleTimeout;
+                if (timeout == std::chrono::nanoseconds::zero()) {
+                    parker.park();
+                } else if (!parker.parkFor(timeout)) {
+                    if (fireTimeoutCallback()) {
+                        state = STOPPED;
+                        return;
+                    }
+                    continue;
+                }
+                // A permit without a task (setIdleTimeout, stop) leaves currentTask to assignTask.
+                if (!assigned.load(std::memory_order_acquire)) {
                     continue;
                 }
                 if (state == STOPPED) {
                     fireStopCallback();
                     return;
                 }
-                currentTask->operator()();
-                currentTask = nullptr;
-                state = IDLE;
+                do {
+                    runCurrentTask();
+                    currentTask = nullptr;
+                } while (fireFetchCallback());
+                assigned.store(false, std::memory_order_relaxed);
+                // A stop() that arrived during the run wins; overwriting it would park the worker for good.
+                WorkerState running = RUNNING;
+                state.compare_exchange_strong(running, IDLE);
                 fireIdleCallback();
             }
         });
     }
 
+    void runCurrentTask() {
+        if (currentToken.canBeCancelled()) {
+            const CancellationScope scope(std::exchange(currentToken, {}));
+            runTrackedTask();
+            return;
+        }
+        runTrackedTask();
+    }
+
+    void runTrackedTask() {
+#ifdef FLOW_POOL_METRICS
+        if (metrics != nullptr) {
+            metrics->run(queuedAt, currentTask);
+            metrics = nullptr;
+            return;
+        }
+#endif
+        currentTask();
+    }
+
+    // A stopped worker stays stopped and hands the task back through the stop callback.
     void runTask() {
-        state = RUNNING;
-        mainSemaphore.unlock();
+        WorkerState idle = IDLE;
+        state.compare_exchange_strong(idle, RUNNING);
+        parker.unpark();
     }
 
     void fireStopCallback() {
@@ -84,15 +191,34 @@ private:
         }
     }
 
+    bool fireFetchCallback() {
+        return onFetchCallback != nullptr && onFetchCallback->operator()(this, currentTask);
+    }
+
+    bool fireTimeoutCallback() {
+        return onTimeoutCallback != nullptr && onTimeoutCallback->operator()(this);
+    }
+
     void fireIdleCallback() {
         if (onIdleCallback != nullptr) {
             onIdleCallback->operator()(this);
         }
     }
 
-    Semaphore mainSemaphore;
+    FlowAffinity::Placement placement;
+    Parker parker;
+    std::atomic<std::chrono::nanoseconds> idleTimeout = {std::chrono::nanoseconds::zero()};
     std::thread mainThread;
-    std::shared_ptr<std::function<void()>> currentTask;
+    InlineTask currentTask;
+    CancellationToken currentToken;
+    // Set once assignTask has moved the task in; the worker only touches currentTask after seeing it.
+    std::atomic_bool assigned = {false};
+#ifdef FLOW_POOL_METRICS
+    PoolMetrics *metrics = nullptr;
+    uint64_t queuedAt = 0;
+#endif
     std::shared_ptr<std::function<void(Worker *worker)>> onIdleCallback;
     std::shared_ptr<std::function<void(Worker *worker)>> onStopCallback;
+    std::shared_ptr<std::function<bool(Worker *worker, InlineTask &task)>> onFetchCallback;
+    std::shared_ptr<std::function<bool(Worker *worker)>> onTimeoutCallback;
 };
\ No newline at end of file
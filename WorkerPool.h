@@ -4,114 +4,578 @@
 #include <memory>
 #include <functional>
 #include <mutex>
-#include "MultiSemaphore.h"
+#include "CompletionLatch.h"
 #include <queue>
+#include <deque>
+#include <algorithm>
+#include <chrono>
+#include "TaskQueue.h"
 #include "FlowLog.h"
 #include "Worker.h"
+#include "FlowAffinity.h"
+#include "PoolMetrics.h"
+#include "CancellationToken.h"
+#include "AdmissionControl.h"
+#include "FlowTask.h"
 #include <functional>
 #include <map>
 
+// Bounds for an elastic pool: above minWorkers a worker that stays idle for idleTimeout retires, and
+// while no worker is idle a new one (up to maxWorkers) is spawned once spawnDepth tasks are queued or
+// no task has been picked up for spawnDelay.
+struct ElasticLimits {
+    size_t minWorkers = 1;
+    size_t maxWorkers = std::thread::hardware_concurrency();
+    std::chrono::nanoseconds idleTimeout = std::chrono::seconds(10);
+    size_t spawnDepth = 16;
+    std::chrono::nanoseconds spawnDelay = std::chrono::milliseconds(1);
+};
+
 class WorkerPool {
 public:
-    WorkerPool(const size_t &workerCount = std::thread::hardware_concurrency()) : workerCount(workerCount) {
+    // With AffinityPolicy::numaNodes() every NUMA node gets its own task store: tasks are queued on
+    // the node of the submitting thread and workers serve their own node first, only taking work from
+    // other nodes when theirs is empty. capacity is per node.
+    WorkerPool(const size_t &workerCount = std::thread::hardware_concurrency(),
+               const TaskStore &store = TaskStore::LOCKED_QUEUE,
+               const size_t &capacity = 4096,
+               const FlowAffinity::AffinityPolicy &affinity = {}) : affinity(affinity), workerCount(workerCount) {
+        const size_t nodeCount = affinity.policy == FlowAffinity::Policy::NUMA_NODES
+                                 ? FlowAffinity::Topology::get().nodes.size() : 1;
+        for (size_t node = 0; node < nodeCount; ++node) {
+            tasks.emplace_back(std::make_unique<TaskQueue<CancellableTask>>(store, capacity));
+        }
+        idleWorker.resize(nodeCount);
         for (int i = 0; i < workerCount; ++i) {
-            auto worker = std::make_shared<Worker>(workerId);
-            workerMap[workerId] = worker;
-            ++workerId;
-            const auto onIdleCallback = std::make_shared<std::function<void(Worker *worker)>>([&](Worker *worker) {
-                std::unique_lock<std::mutex> lock(poolMutex);
-                toWaitFor.unlock();
-                if (!isStopping)
-                    idleWorker.push(workerMap.at(worker->getId()));
-                startWorker();
-//                LOG_INFO << "Idle: "<< "Locks " << toWaitFor.count() << " Tasks " << tasks.size();
-            });
-            worker->onIdle(onIdleCallback);
-            const auto onStopCallback = std::make_shared<std::function<void(Worker *worker)>>([&](Worker *worker) {
-                toWaitFor.unlock();
-                startWorker();
-                LOG_INFO << "Stop: " << "Locks " << toWaitFor.count() << " Tasks " << tasks.size();
-            });
-            worker->onStop(onStopCallback);
-            idleWorker.push(worker);
+            registerWorker();
         }
     }
 
+    // Joins the workers before any member goes: a worker finishing its last task still runs the idle
+    // callback, which touches the idle lists and the task stores.
     ~WorkerPool() {
         stop();
+        for (const auto &worker: workers()) {
+            worker->join();
+        }
+        reap();
     }
 
     void wait() {
         toWaitFor.wait();
     }
 
-    void addTask(std::shared_ptr<std::function<void()>> function) {
-        std::lock_guard guard(tasksMutex);
-        tasks.emplace(function);
-        toWaitFor.addLock();
+    SubmitResult addTask(std::shared_ptr<std::function<void()>> function) {
+        return addTask(InlineTask([function] {
+            (*function)();
+        }));
     }
 
+    SubmitResult addTask(InlineTask function) {
+        return addTask(CancellableTask(std::move(function)));
+    }
+
+    // The task is shed instead of run if the token is cancelled or the deadline has passed by the
+    // time a worker would take it; while it runs, CancellationToken::current() returns the token.
+    SubmitResult addTask(InlineTask function, const CancellationToken &token,
+                         const CancellableTask::Clock::time_point &deadline =
+                         CancellableTask::Clock::time_point::max()) {
+        return addTask(CancellableTask(std::move(function), token, deadline));
+    }
+
+    SubmitResult addTask(InlineTask function, const CancellableTask::Clock::time_point &deadline) {
+        return addTask(CancellableTask(std::move(function), {}, deadline));
+    }
+
+    // Applies the admission policy once the queue is full, see setAdmission.
+    SubmitResult addTask(CancellableTask task) {
+        return submit(std::move(task), true);
+    }
+
+    // Never blocks or runs the task on the caller: a full queue rejects it whatever the policy.
+    SubmitResult trySubmit(InlineTask function) {
+        return trySubmit(CancellableTask(std::move(function)));
+    }
+
+    SubmitResult trySubmit(CancellableTask task) {
+        return submit(std::move(task), false);
+    }
+
+    // co_await pool.schedule() continues the coroutine on a worker and starts the pool. The co_await
+    // throws if the pool rejects or sheds the coroutine instead.
+    auto schedule() {
+        return FlowCoroutine::ScheduleAwaiter([this](InlineTask task) {
+            const SubmitResult result = addTask(std::move(task));
+            start();
+            return result;
+        });
+    }
+
+    // Caps the number of queued tasks (0 means unbounded, the default) and picks what addTask does
+    // once the cap is reached. A task blocking on a full pool it runs on can deadlock the pool.
+    void setAdmission(const size_t &capacity, const AdmissionPolicy &policy = AdmissionPolicy::BLOCK) {
+        admission.setLimit(capacity, policy);
+    }
+
+    size_t getHighWaterMark() const {
+        return admission.getHighWaterMark();
+    }
+
+    size_t getRejectedCount() const {
+        return admission.getRejectedCount();
+    }
+
+    // In batch drain mode a worker keeps pulling from the task store after each task and only goes
+    // idle once it is empty, and addTask dispatches to idle workers once the pool has been started.
+    void setBatchDrain(const bool enabled) {
+        batchDrain = enabled;
+    }
+
+    // How long an idle worker spins for its next task before it sleeps.
+    void setSpinWindow(const std::chrono::nanoseconds &window) {
+        spinWindow = window;
+        std::lock_guard<std::mutex> guard(workerMapMutex);
+        for (const auto &entry: workerMap) {
+            entry.second->setSpinWindow(window);
+        }
+    }
+
+    // Lets the pool grow and shrink between the limits instead of keeping workerCount workers. Call it
+    // before start(); the constructed workers count towards the limits.
+    void setElastic(const ElasticLimits &toUse) {
+        {
+            std::lock_guard<std::mutex> guard(workerMapMutex);
+            limits = toUse;
+            limits.minWorkers = std::max<size_t>(limits.minWorkers, 1);
+            limits.maxWorkers = std::max(limits.maxWorkers, limits.minWorkers);
+            lastDequeue = now();
+            elastic = true;
+            for (const auto &entry: workerMap) {
+                entry.second->setIdleTimeout(limits.idleTimeout);
+            }
+        }
+        reap();
+    }
+
+    size_t getWorkerCount() const {
+        return liveWorkers;
+    }
+
+    size_t getSpawnCount() const {
+        return spawns;
+    }
+
+    size_t getRetirementCount() const {
+        return retirements;
+    }
+
+    // Tasks dropped without running because they were cancelled, expired or still queued at stop().
+    size_t getShedCount() const {
+        return shed;
+    }
+
+    // Tasks handed to a worker.
+    size_t getExecutedCount() const {
+        return executed;
+    }
+
+    // Sheds every queued task and returns how many there were; running tasks are not affected.
+    size_t cancelQueued() {
+        size_t count = 0;
+        while (dropOldest()) {
+            ++count;
+        }
+        return count;
+    }
+
+    // Stops the workers once they finish their current task and sheds everything still queued.
     void stop() {
         isStopping = true;
-        for (const auto entry : workerMap) {
-            entry.second->stop();
+        {
+            std::lock_guard<std::mutex> guard(workerMapMutex);
+            for (const auto &entry : workerMap) {
+                entry.second->stop();
+            }
         }
+        cancelQueued();
     }
 
     void start() {
-        std::unique_lock<std::mutex> lock(poolMutex, std::try_to_lock);
-        if (lock.owns_lock()) {
-            startWorker();
+        isStarted = true;
+        dispatch();
+        if (elastic && idleCount == 0) {
+            grow();
         }
     }
 
     size_t size() const {
-        return tasks.size();
+        size_t total = 0;
+        for (const auto &queue: tasks) {
+            total += queue->size();
+        }
+        return total;
+    }
+
+    // Where the worker with that id is pinned; a default Placement for unknown ids.
+    FlowAffinity::Placement getPlacement(const size_t &id) const {
+        std::lock_guard<std::mutex> guard(workerMapMutex);
+        const auto entry = workerMap.find(id);
+        if (entry == workerMap.end()) {
+            return {};
+        }
+        return {entry->second->getCpu(), entry->second->getNode()};
+    }
+
+#ifdef FLOW_POOL_METRICS
+
+    PoolMetricsSnapshot getMetrics() const {
+        return metrics.snapshot();
     }
 
+#endif
+
     void join() {
         isJoin = true;
-        while (!tasks.empty()) {
+        while (!empty()) {
             start();
             toWaitFor.wait();
-            for (const auto entry : workerMap) {
-                entry.second->join();
+            for (const auto &worker : workers()) {
+                worker->join();
             }
         }
     }
 
 private:
+    SubmitResult submit(CancellableTask task, const bool &mayBlock) {
+#ifdef FLOW_POOL_METRICS
+        task.queuedAt = metrics.taskQueued();
+#endif
+        const size_t capacity = admission.getCapacity();
+        if (capacity != 0 && admission.size() >= capacity) {
+            start();
+        }
+        const SubmitResult result = admission.admit(mayBlock, [&] {
+            toWaitFor.addLock();
+            auto &queue = *tasks[tasks.size() == 1 ? 0 : FlowAffinity::currentNode() % tasks.size()];
+            while (!queue.tryPush(std::move(task))) {
+                start();
+                std::this_thread::yield();
+            }
+        }, [&] {
+            return dropOldest();
+        }, [&] {
+            if (task.expired()) {
+                ++shed;
+#ifdef FLOW_POOL_METRICS
+                metrics.taskDiscarded();
+#endif
+            } else {
+                ++executed;
+#ifdef FLOW_POOL_METRICS
+                const CancellationScope scope(task.token);
+                metrics.run(task.queuedAt, task.task);
+#else
+                task.run();
+#endif
+            }
+        });
+        if (result == SubmitResult::REJECTED) {
+#ifdef FLOW_POOL_METRICS
+            metrics.taskDiscarded();
+#endif
+            return result;
+        }
+        if (elastic && idleCount == 0) {
+            grow();
+        }
+        if (batchDrain && isStarted) {
+            start();
+        }
+        return result;
+    }
+
+    // Sheds the task at the head of the first non-empty node queue.
+    bool dropOldest() {
+        CancellableTask entry;
+        for (const auto &queue: tasks) {
+            if (queue->tryPop(entry)) {
+                admission.release();
+                discard(entry);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Lock order: poolMutex, tasksMutex, workerMapMutex.
+    std::shared_ptr<Worker> registerWorker() {
+        auto worker = std::make_shared<Worker>(workerId);
+        worker->pin(FlowAffinity::Topology::get().place(affinity, workerId));
+        ++workerId;
+        const auto onFetchCallback = std::make_shared<std::function<bool(Worker *worker, InlineTask &task)>>(
+                [&](Worker *worker, InlineTask &task) {
+                    if (!batchDrain || isStopping || !popTask(nodeOf(worker), task, *worker)) {
+                        return false;
+                    }
+                    markDequeue();
+                    toWaitFor.unlock();
+                    return true;
+                });
+        worker->onFetch(onFetchCallback);
+        const auto onIdleCallback = std::make_shared<std::function<void(Worker *worker)>>([&](Worker *worker) {
+            {
+                std::unique_lock<std::mutex> lock(poolMutex);
+                toWaitFor.unlock();
+                if (!isStopping) {
+                    idleWorker[nodeOf(worker)].push_back(find(worker->getId()));
+                    ++idleCount;
+                }
+            }
+            dispatch();
+//                LOG_INFO << "Idle: "<< "Locks " << toWaitFor.count() << " Tasks " << tasks.size();
+        });
+        worker->onIdle(onIdleCallback);
+        const auto onStopCallback = std::make_shared<std::function<void(Worker *worker)>>([&](Worker *worker) {
+            toWaitFor.unlock();
+            startWorker();
+            LOG_INFO << "Stop: " << "Locks " << toWaitFor.count() << " Tasks " << size();
+        });
+        worker->onStop(onStopCallback);
+        const auto onTimeoutCallback = std::make_shared<std::function<bool(Worker *worker)>>([&](Worker *worker) {
+            return retire(worker);
+        });
+        worker->onTimeout(onTimeoutCallback);
+        worker->setSpinWindow(spinWindow);
+        {
+            std::lock_guard<std::mutex> guard(workerMapMutex);
+            workerMap[worker->getId()] = worker;
+            if (elastic) {
+                worker->setIdleTimeout(limits.idleTimeout);
+            }
+        }
+        idleWorker[nodeOf(worker.get())].push_back(worker);
+        ++idleCount;
+        ++liveWorkers;
+#ifdef FLOW_POOL_METRICS
+        metrics.setWorkers(liveWorkers);
+#endif
+        return worker;
+    }
+
+    // Spawns a worker when every worker is busy and the backlog is deep or has not moved for too long.
+    void grow() {
+        while (!isStopping && liveWorkers < limits.maxWorkers) {
+            const size_t depth = size();
+            if (depth == 0 || (depth < limits.spawnDepth && now() - lastDequeue < limits.spawnDelay.count())) {
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> poolGuard(poolMutex);
+                std::lock_guard<std::mutex> tasksGuard(tasksMutex);
+                if (isStopping || idleCount != 0 || liveWorkers >= limits.maxWorkers) {
+                    break;
+                }
+                registerWorker();
+                ++spawns;
+            }
+            dispatch();
+        }
+        reap();
+    }
+
+    // Runs on the timed out worker; it only retires while it is still queued as idle.
+    bool retire(Worker *worker) {
+        std::lock_guard<std::mutex> poolGuard(poolMutex);
+        std::lock_guard<std::mutex> tasksGuard(tasksMutex);
+        if (!elastic || isStopping || isJoin || worker->state == RUNNING || liveWorkers <= limits.minWorkers) {
+            return false;
+        }
+        auto &idle = idleWorker[nodeOf(worker)];
+        const auto position = std::find_if(idle.begin(), idle.end(), [&](const std::shared_ptr<Worker> &entry) {
+            return entry.get() == worker;
+        });
+        if (position == idle.end()) {
+            return false;
+        }
+        idle.erase(position);
+        --idleCount;
+        --liveWorkers;
+        ++retirements;
+#ifdef FLOW_POOL_METRICS
+        metrics.setWorkers(liveWorkers);
+#endif
+        std::lock_guard<std::mutex> guard(workerMapMutex);
+        const auto entry = workerMap.find(worker->getId());
+        retired.emplace_back(std::move(entry->second));
+        workerMap.erase(entry);
+        return true;
+    }
+
+    // Joins retired workers; a worker cannot join its own thread, so this runs on other threads.
+    void reap() {
+        std::vector<std::shared_ptr<Worker>> toJoin;
+        {
+            std::lock_guard<std::mutex> guard(workerMapMutex);
+            toJoin.swap(retired);
+        }
+        for (const auto &worker: toJoin) {
+            worker->join();
+        }
+    }
+
+    std::shared_ptr<Worker> find(const size_t &id) {
+        std::lock_guard<std::mutex> guard(workerMapMutex);
+        return workerMap.at(id);
+    }
+
+    std::vector<std::shared_ptr<Worker>> workers() {
+        std::lock_guard<std::mutex> guard(workerMapMutex);
+        std::vector<std::shared_ptr<Worker>> result;
+        for (const auto &entry: workerMap) {
+            result.emplace_back(entry.second);
+        }
+        return result;
+    }
+
+    static int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void markDequeue() {
+        if (elastic) {
+            lastDequeue = now();
+        }
+    }
+
+    // Whoever holds poolMutex re-runs startWorker while dispatch requests keep coming in, so a task
+    // pushed while another thread is dispatching is never left behind.
+    void dispatch() {
+        dispatchRequested = true;
+        while (dispatchRequested) {
+            std::unique_lock<std::mutex> lock(poolMutex, std::try_to_lock);
+            if (!lock.owns_lock()) {
+                return;
+            }
+            dispatchRequested = false;
+            startWorker();
+        }
+    }
+
+    // Node-local tasks go out first; only then do idle workers take tasks queued on other nodes.
     void startWorker() {
         std::lock_guard guard(tasksMutex);
-        while (!tasks.empty() && !idleWorker.empty()) {
-            try {
-                const auto toRun = tasks.front();
-                tasks.pop();
-                const auto worker = idleWorker.front();
-                idleWorker.pop();
-                worker->assignTask(toRun);
-            } catch (const std::system_error &e) {
-                LOG_WARNING << "Code " << e.code()
-                            << " meaning " << e.what() << '\n';
-                tasks.pop();
-                toWaitFor.unlock();
+        InlineTask toRun;
+        for (const bool local: {true, false}) {
+            for (size_t node = 0; node < idleWorker.size(); ++node) {
+                auto &idle = idleWorker[node];
+                while (!idle.empty() && (local ? popFrom(*tasks[node], toRun, *idle.front())
+                                               : popTask(node, toRun, *idle.front()))) {
+                    try {
+                        const auto worker = idle.front();
+                        idle.pop_front();
+                        --idleCount;
+                        markDequeue();
+                        worker->assignTask(std::move(toRun));
+                    } catch (const std::system_error &e) {
+                        LOG_WARNING << "Code " << e.code()
+                                    << " meaning " << e.what() << '\n';
+                        toWaitFor.unlock();
+                    }
+                }
             }
         }
-        if (isJoin && tasks.empty() && toWaitFor.count() == 0) {
-            for (const auto entry : workerMap) {
+        if (isJoin && empty() && toWaitFor.count() == 0) {
+            std::lock_guard<std::mutex> mapGuard(workerMapMutex);
+            for (const auto &entry : workerMap) {
                 entry.second->stop();
             }
         }
     }
 
-    bool isStopping = false;
-    bool isJoin = false;
+    size_t nodeOf(Worker *worker) const {
+        return tasks.size() == 1 || worker->getNode() < 0 ? 0 : worker->getNode() % tasks.size();
+    }
+
+    bool popTask(const size_t &node, InlineTask &task, Worker &worker) {
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            if (popFrom(*tasks[(node + i) % tasks.size()], task, worker)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Sheds expired tasks until it finds one that may still run; worker is the one that will run it.
+    bool popFrom(TaskQueue<CancellableTask> &queue, InlineTask &task, [[maybe_unused]] Worker &worker) {
+        CancellableTask entry;
+        while (queue.tryPop(entry)) {
+            admission.release();
+            if (entry.expired()) {
+                discard(entry);
+                continue;
+            }
+#ifdef FLOW_POOL_METRICS
+            worker.trackNext(metrics, entry.queuedAt);
+#endif
+            worker.cancelWith(std::move(entry.token));
+            task = std::move(entry.task);
+            ++executed;
+            return true;
+        }
+        return false;
+    }
+
+    // The task goes last: destroying it may resume a coroutine (FlowCoroutine::PendingResume), which
+    // must find the pool's bookkeeping settled.
+    void discard(CancellableTask &entry) {
+        ++shed;
+#ifdef FLOW_POOL_METRICS
+        metrics.taskDiscarded();
+#endif
+        toWaitFor.unlock();
+        entry.task = nullptr;
+    }
+
+    bool empty() const {
+        for (const auto &queue: tasks) {
+            if (!queue->empty()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::atomic_bool isStopping = {false};
+    std::atomic_bool isJoin = {false};
+    std::atomic_bool isStarted = {false};
+    std::atomic_bool batchDrain = {false};
+    std::atomic_bool dispatchRequested = {false};
+    std::atomic_bool elastic = {false};
     std::atomic_size_t workerId;
-    std::queue<std::shared_ptr<std::function<void()>>> tasks;
-    MultiSemaphore toWaitFor;
+    std::atomic_size_t idleCount = {0};
+    std::atomic_size_t liveWorkers = {0};
+    std::atomic_size_t spawns = {0};
+    std::atomic_size_t retirements = {0};
+    std::atomic_size_t shed = {0};
+    std::atomic_size_t executed = {0};
+    std::atomic<int64_t> lastDequeue = {0};
+    ElasticLimits limits;
+    std::chrono::nanoseconds spinWindow = std::chrono::nanoseconds::zero();
+    const FlowAffinity::AffinityPolicy affinity;
+    std::vector<std::unique_ptr<TaskQueue<CancellableTask>>> tasks;
+    AdmissionControl admission;
+    PendingTasks toWaitFor;
     std::mutex poolMutex;
     std::mutex tasksMutex;
+    mutable std::mutex workerMapMutex;
     size_t workerCount;
-    std::queue<std::shared_ptr<Worker>> idleWorker;
+    // A running task reports to metrics and a timed out worker retires into retired until the workers
+    // are joined, so both outlive the worker containers.
+#ifdef FLOW_POOL_METRICS
+    PoolMetrics metrics;
+#endif
+    std::vector<std::shared_ptr<Worker>> retired;
+    std::vector<std::deque<std::shared_ptr<Worker>>> idleWorker;
     std::unordered_map<size_t, std::shared_ptr<Worker>> workerMap;
 };
\ No newline at end of file
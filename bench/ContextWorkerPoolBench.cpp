@@ -0,0 +1,67 @@
+#include "FlowLog.h"
+#include "Worker.h"
+#include "ContextWorkerPool.h"
+#include "FlowBench.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Per-task overhead with a large worker context (64 KiB of scratch buffer): the by-value
+// std::function<void(ContextType)> overload that copies the context for every task, a ContextTask
+// taking it by reference, and addTasks() batches of 64.
+namespace {
+    struct LargeContext {
+        std::vector<char> scratch = std::vector<char>(64 * 1024);
+        size_t handled = 0;
+    };
+
+    template<class Submit>
+    void measure(const std::string &name, const size_t &count, Submit submit) {
+        ContextWorkerPool<LargeContext> pool(2);
+        std::atomic_size_t runs = {0};
+        FlowBench::report(name, count, FlowBench::seconds([&] {
+            submit(pool, runs, count);
+            pool.start();
+            pool.wait();
+        }));
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t count = FlowBench::scaled(100000, FlowBench::scale(argc, argv));
+    measure("context by value", count, [](ContextWorkerPool<LargeContext> &pool, std::atomic_size_t &runs,
+                                           const size_t &total) {
+        const auto task = std::make_shared<std::function<void(LargeContext)>>([&runs](LargeContext context) {
+            context.scratch[0] = 1;
+            runs.fetch_add(1, std::memory_order_relaxed);
+        });
+        for (size_t i = 0; i < total; ++i) {
+            pool.addTask(task);
+        }
+    });
+    measure("context by reference", count, [](ContextWorkerPool<LargeContext> &pool, std::atomic_size_t &runs,
+                                               const size_t &total) {
+        for (size_t i = 0; i < total; ++i) {
+            pool.addTask(ContextTask<LargeContext>([&runs](LargeContext &context) {
+                ++context.handled;
+                runs.fetch_add(1, std::memory_order_relaxed);
+            }));
+        }
+    });
+    measure("addTasks, batches of 64", count, [](ContextWorkerPool<LargeContext> &pool, std::atomic_size_t &runs,
+                                                 const size_t &total) {
+        std::vector<ContextTask<LargeContext>> batch;
+        for (size_t i = 0; i < total; i += batch.size()) {
+            batch.clear();
+            for (size_t j = 0; j < 64 && i + j < total; ++j) {
+                batch.emplace_back([&runs](LargeContext &context) {
+                    ++context.handled;
+                    runs.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+            pool.addTasks(batch);
+        }
+    });
+    return 0;
+}
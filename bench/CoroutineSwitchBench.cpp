@@ -0,0 +1,68 @@
+#include "FlowLog.h"
+#include "Worker.h"
+#include "WorkerPool.h"
+#include "CountingSemaphore.h"
+#include "FlowTask.h"
+#include "FlowBench.h"
+#include <thread>
+
+// Coroutine switch cost against handing work to another thread: a co_await of a child FlowTask
+// (suspend, run, resume on the same thread), a co_await pool.schedule() hop through a WorkerPool, and a
+// CountingSemaphore ping-pong between two threads.
+namespace {
+    FlowTask<size_t> child(const size_t value) {
+        co_return value + 1;
+    }
+
+    FlowTask<size_t> switches(const size_t count) {
+        size_t sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            sum += co_await child(i);
+        }
+        co_return sum;
+    }
+
+    FlowTask<size_t> hops(WorkerPool &pool, const size_t count) {
+        size_t hopped = 0;
+        for (size_t i = 0; i < count; ++i) {
+            co_await pool.schedule();
+            ++hopped;
+        }
+        co_return hopped;
+    }
+}
+
+int main(int argc, char **argv) {
+    const double factor = FlowBench::scale(argc, argv);
+
+    const size_t switchCount = FlowBench::scaled(10000000, factor);
+    size_t sum = 0;
+    FlowBench::report("coroutine switch", switchCount, FlowBench::seconds([&] {
+        sum = FlowCoroutine::syncWait(switches(switchCount));
+    }));
+
+    const size_t hopCount = FlowBench::scaled(100000, factor);
+    WorkerPool pool(1);
+    size_t hopped = 0;
+    FlowBench::report("pool schedule hop", hopCount, FlowBench::seconds([&] {
+        hopped = FlowCoroutine::syncWait(hops(pool, hopCount));
+    }));
+
+    const size_t handoffCount = FlowBench::scaled(100000, factor);
+    CountingSemaphore ping;
+    CountingSemaphore pong;
+    std::thread partner([&] {
+        for (size_t i = 0; i < handoffCount; ++i) {
+            ping.acquire();
+            pong.release();
+        }
+    });
+    FlowBench::report("thread handoff round trip", handoffCount, FlowBench::seconds([&] {
+        for (size_t i = 0; i < handoffCount; ++i) {
+            ping.release();
+            pong.acquire();
+        }
+    }));
+    partner.join();
+    return sum != 0 && hopped == hopCount ? 0 : 1;
+}
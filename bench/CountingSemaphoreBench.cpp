@@ -0,0 +1,59 @@
+#include "CountingSemaphore.h"
+#include "Semaphore.h"
+#include "FlowBench.h"
+#include <chrono>
+#include <string>
+#include <thread>
+
+// Ping-pong handoff latency between two threads: the mutex and condition variable Semaphore against
+// CountingSemaphore, sleeping right away and with a spin window.
+namespace {
+    template<class Ping, class Pong>
+    double pingPong(const size_t &rounds, Ping ping, Pong pong) {
+        std::thread partner([&] {
+            for (size_t i = 0; i < rounds; ++i) {
+                pong();
+            }
+        });
+        const double elapsed = FlowBench::seconds([&] {
+            for (size_t i = 0; i < rounds; ++i) {
+                ping();
+            }
+        });
+        partner.join();
+        return elapsed;
+    }
+
+    void counting(const std::string &name, const size_t &rounds, const std::chrono::nanoseconds &spinWindow) {
+        CountingSemaphore ping(0, spinWindow);
+        CountingSemaphore pong(0, spinWindow);
+        FlowBench::report(name + " round trip", rounds, pingPong(rounds, [&] {
+            ping.release();
+            pong.acquire();
+        }, [&] {
+            ping.acquire();
+            pong.release();
+        }));
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t rounds = FlowBench::scaled(100000, FlowBench::scale(argc, argv));
+    {
+        // Semaphore's lock() only blocks while a lock is held, so each side holds one up front.
+        Semaphore ping;
+        Semaphore pong;
+        ping.addLock();
+        pong.addLock();
+        FlowBench::report("Semaphore round trip", rounds, pingPong(rounds, [&] {
+            ping.unlock();
+            pong.lock();
+        }, [&] {
+            ping.lock();
+            pong.unlock();
+        }));
+    }
+    counting("CountingSemaphore", rounds, std::chrono::nanoseconds::zero());
+    counting("CountingSemaphore 10us spin", rounds, std::chrono::microseconds(10));
+    return 0;
+}
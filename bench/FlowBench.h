@@ -0,0 +1,45 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Timing helpers for the benchmarks. Each benchmark takes an optional scale factor as its first
+// argument so a quick run and a long one use the same binary.
+namespace FlowBench {
+    using Clock = std::chrono::steady_clock;
+
+    inline double scale(int argc, char **argv) {
+        return argc > 1 ? std::max(std::atof(argv[1]), 0.001) : 1.0;
+    }
+
+    inline size_t scaled(const size_t &count, const double &factor) {
+        return std::max<size_t>(1, static_cast<size_t>(static_cast<double>(count) * factor));
+    }
+
+    template<class Function>
+    double seconds(Function function) {
+        const auto start = Clock::now();
+        function();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    inline void report(const std::string &name, const size_t &operations, const double &elapsed) {
+        std::cout << name << ": " << operations << " ops in " << elapsed * 1e3 << " ms, "
+                  << elapsed * 1e9 / static_cast<double>(operations) << " ns/op" << std::endl;
+    }
+
+    // Nearest-rank percentile of samples, which it sorts.
+    template<class Sample>
+    Sample percentile(std::vector<Sample> &samples, const double &fraction) {
+        if (samples.empty()) {
+            return {};
+        }
+        std::sort(samples.begin(), samples.end());
+        const auto rank = static_cast<size_t>(fraction * static_cast<double>(samples.size() - 1));
+        return samples[rank];
+    }
+}
@@ -0,0 +1,64 @@
+#include "FlowLog.h"
+#include "FlowBench.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// Cost of a LOG_INFO call seen by the caller at 1, 8 and 64 threads, logging to a file and to stdout
+// (sent to /dev/null while timing): the synchronous path against the async writer with a blocking and
+// with a dropping queue. Async lines still queued when the timing ends are flushed untimed.
+namespace {
+    double logFrom(const size_t &threads, const size_t &calls) {
+        std::vector<std::thread> workers;
+        std::cout.flush();
+        const int console = dup(STDOUT_FILENO);
+        const int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        const double elapsed = FlowBench::seconds([&] {
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (size_t i = 0; i < calls / threads; ++i) {
+                        LOG_INFO << "worker " << t << " handled request " << i;
+                    }
+                });
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        });
+        logging::flush();
+        std::cout.flush();
+        dup2(console, STDOUT_FILENO);
+        close(devNull);
+        close(console);
+        return elapsed;
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t calls = FlowBench::scaled(200000, FlowBench::scale(argc, argv));
+    const auto logFile = std::filesystem::temp_directory_path() / "flow_log_bench.log";
+    logging::setLogFile(logFile.string());
+    for (const size_t threads: {1, 8, 64}) {
+        const std::string suffix = ", " + std::to_string(threads) + " threads";
+        FlowBench::report("sync" + suffix, calls, logFrom(threads, calls));
+
+        logging::enableAsync();
+        FlowBench::report("async block" + suffix, calls, logFrom(threads, calls));
+        logging::disableAsync();
+
+        logging::asyncOptions dropping;
+        dropping.onOverflow = logging::overflow::DROP;
+        logging::enableAsync(dropping);
+        const uint64_t droppedBefore = logging::getDroppedCount();
+        FlowBench::report("async drop" + suffix, calls, logFrom(threads, calls));
+        std::cout << "  dropped " << logging::getDroppedCount() - droppedBefore << " lines" << std::endl;
+        logging::disableAsync();
+    }
+    std::filesystem::remove(logFile);
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include "FlowParallel.h"
+#include "FlowBench.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// FlowParallel against serial loops from 1e3 elements up. Index ranges go up to 1e9 (times the scale
+// factor) without storage; for_each, reduce, inclusive_scan and sort run on vectors up to 1e7.
+namespace {
+    double work(const size_t &index) {
+        return std::sqrt(static_cast<double>(index));
+    }
+
+    void compare(const std::string &name, const size_t &count, const double &serial, const double &parallel) {
+        std::cout << name << " n=" << count << ": serial " << serial * 1e3 << " ms, parallel " << parallel * 1e3
+                  << " ms, speedup " << serial / parallel << std::endl;
+    }
+
+    void indexRange(WorkStealingPool &pool, const size_t &count) {
+        double serialSum = 0;
+        const double serial = FlowBench::seconds([&] {
+            for (size_t i = 0; i < count; ++i) {
+                serialSum += work(i);
+            }
+        });
+        std::vector<double> partials((count + 65535) / 65536);
+        const double parallel = FlowBench::seconds([&] {
+            FlowParallel::forEachChunk(pool, count, 65536, [&](const size_t &chunk, const size_t &begin,
+                                                               const size_t &end) {
+                double sum = 0;
+                for (size_t i = begin; i < end; ++i) {
+                    sum += work(i);
+                }
+                partials[chunk] = sum;
+            });
+        });
+        const double parallelSum = std::accumulate(partials.begin(), partials.end(), 0.0);
+        compare(std::string("index sum") + (std::abs(serialSum - parallelSum) > 1e-6 * serialSum ? " (mismatch)" : ""),
+                count, serial, parallel);
+    }
+
+    void vectors(WorkStealingPool &pool, const size_t &count) {
+        std::vector<double> values(count);
+        std::iota(values.begin(), values.end(), 0.0);
+        const auto step = [](double &value) { value = std::sqrt(value + 1.0); };
+        compare("for_each", count, FlowBench::seconds([&] {
+            std::for_each(values.begin(), values.end(), step);
+        }), FlowBench::seconds([&] {
+            FlowParallel::for_each(pool, values.begin(), values.end(), step);
+        }));
+        double sink = 0;
+        compare("reduce", count, FlowBench::seconds([&] {
+            sink += std::accumulate(values.begin(), values.end(), 0.0);
+        }), FlowBench::seconds([&] {
+            sink += FlowParallel::reduce(pool, values.begin(), values.end(), 0.0);
+        }));
+        std::vector<double> scanned(count);
+        compare("inclusive_scan", count, FlowBench::seconds([&] {
+            std::inclusive_scan(values.begin(), values.end(), scanned.begin());
+        }), FlowBench::seconds([&] {
+            FlowParallel::inclusive_scan(pool, values.begin(), values.end(), scanned.begin());
+        }));
+        std::mt19937 random(42);
+        std::vector<uint32_t> toSort(count);
+        std::generate(toSort.begin(), toSort.end(), std::ref(random));
+        auto copy = toSort;
+        compare("sort", count, FlowBench::seconds([&] {
+            std::sort(copy.begin(), copy.end());
+        }), FlowBench::seconds([&] {
+            FlowParallel::sort(pool, toSort.begin(), toSort.end());
+        }));
+        if (sink < 0 || toSort != copy) {
+            std::cout << "mismatch" << std::endl;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const double factor = FlowBench::scale(argc, argv);
+    WorkStealingPool pool(std::max(1u, std::thread::hardware_concurrency()));
+    for (size_t count = 1000; count <= FlowBench::scaled(1000000000, factor); count *= 10) {
+        indexRange(pool, count);
+    }
+    for (size_t count = 1000; count <= FlowBench::scaled(10000000, factor); count *= 10) {
+        vectors(pool, count);
+    }
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include "FlowLog.h"
+#include "WorkerPool.h"
+#include "FlowBench.h"
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <new>
+
+// Heap allocations per submitted task: the shared_ptr<std::function> overload the pools started
+// with against InlineTask, for a lambda capturing three pointers. The pool uses the preallocated
+// ring so only the task wrapper and the start()/wait() per batch of tasks that fits it allocate.
+namespace {
+    std::atomic_size_t allocations = {0};
+}
+
+void *operator new(size_t size) {
+    ++allocations;
+    if (void *memory = std::malloc(size == 0 ? 1 : size)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+    template<class Submit>
+    void measure(const std::string &name, const size_t &count, Submit submit) {
+        constexpr size_t batch = 1024;
+        WorkerPool pool(1, TaskStore::LOCK_FREE_RING, batch);
+        std::atomic_size_t sum = {0};
+        size_t *a = nullptr, *b = nullptr;
+        pool.start();
+        pool.wait();
+        const size_t before = allocations;
+        const double elapsed = FlowBench::seconds([&] {
+            for (size_t done = 0; done < count; done += batch) {
+                for (size_t i = 0; i < batch; ++i) {
+                    submit(pool, [&sum, a, b] { sum.fetch_add(a == b ? 1 : 0, std::memory_order_relaxed); });
+                }
+                pool.start();
+                pool.wait();
+            }
+        });
+        const size_t submitted = (count + batch - 1) / batch * batch;
+        FlowBench::report(name, submitted, elapsed);
+        std::cout << name << ": " << static_cast<double>(allocations - before) / static_cast<double>(submitted)
+                  << " allocations/task" << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t count = FlowBench::scaled(1000000, FlowBench::scale(argc, argv));
+    measure("shared_ptr<std::function>", count, [](WorkerPool &pool, auto task) {
+        pool.addTask(std::make_shared<std::function<void()>>(task));
+    });
+    measure("InlineTask", count, [](WorkerPool &pool, auto task) {
+        pool.addTask(InlineTask(task));
+    });
+    return 0;
+}
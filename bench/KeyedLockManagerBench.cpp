@@ -0,0 +1,58 @@
+#include "KeyedLockManager.h"
+#include "FlowBench.h"
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+// Lock/unlock throughput over 1M distinct keys: one global mutex guarding a set of locked keys, the
+// way IdSemaphore used to serialise, against KeyedLockManager with 1, 64 and 256 shards.
+namespace {
+    template<class Lock>
+    double run(const std::vector<std::string> &keys, const size_t &threads, Lock lock) {
+        std::vector<std::thread> workers;
+        return FlowBench::seconds([&] {
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (size_t i = t; i < keys.size(); i += threads) {
+                        lock(keys[i]);
+                    }
+                });
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        });
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t keyCount = FlowBench::scaled(1000000, FlowBench::scale(argc, argv));
+    std::vector<std::string> keys;
+    keys.reserve(keyCount);
+    for (size_t i = 0; i < keyCount; ++i) {
+        keys.push_back("user-" + std::to_string(i));
+    }
+    for (const size_t threads: {1, 4, 8}) {
+        const std::string suffix = ", " + std::to_string(threads) + " threads";
+        std::mutex global;
+        std::unordered_set<std::string> locked;
+        FlowBench::report("global mutex" + suffix, keyCount, run(keys, threads, [&](const std::string &key) {
+            {
+                std::lock_guard<std::mutex> guard(global);
+                locked.insert(key);
+            }
+            std::lock_guard<std::mutex> guard(global);
+            locked.erase(key);
+        }));
+        for (const size_t shards: {1, 64, 256}) {
+            KeyedLockManager manager(shards);
+            FlowBench::report("KeyedLockManager " + std::to_string(shards) + " shards" + suffix, keyCount,
+                              run(keys, threads, [&](const std::string &key) {
+                                  const auto guard = manager.lock(key);
+                              }));
+        }
+    }
+    return 0;
+}
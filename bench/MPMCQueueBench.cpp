@@ -0,0 +1,54 @@
+#include "TaskQueue.h"
+#include "FlowBench.h"
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Producer/consumer throughput of the lock-free ring against the mutex-guarded std::queue it
+// replaces as the pools' task store, at a few thread counts.
+namespace {
+    double transfer(const TaskStore &store, const size_t &threads, const size_t &perProducer) {
+        TaskQueue<size_t> queue(store, 1024);
+        std::atomic_size_t remaining = {threads * perProducer};
+        std::vector<std::thread> workers;
+        return FlowBench::seconds([&] {
+            for (size_t p = 0; p < threads; ++p) {
+                workers.emplace_back([&] {
+                    for (size_t i = 0; i < perProducer; ++i) {
+                        while (!queue.tryPush(i)) {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+                workers.emplace_back([&] {
+                    size_t value;
+                    while (remaining.load(std::memory_order_relaxed) > 0) {
+                        if (queue.tryPop(value)) {
+                            remaining.fetch_sub(1, std::memory_order_relaxed);
+                        } else {
+                            std::this_thread::yield();
+                        }
+                    }
+                });
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        });
+    }
+}
+
+int main(int argc, char **argv) {
+    const double factor = FlowBench::scale(argc, argv);
+    const size_t total = FlowBench::scaled(1000000, factor);
+    for (const size_t threads: {1, 2, 4, 8}) {
+        const size_t perProducer = total / threads;
+        const std::string pairs = " " + std::to_string(threads) + "P/" + std::to_string(threads) + "C";
+        FlowBench::report("mutex queue" + pairs, perProducer * threads,
+                          transfer(TaskStore::LOCKED_QUEUE, threads, perProducer));
+        FlowBench::report("lock-free ring" + pairs, perProducer * threads,
+                          transfer(TaskStore::LOCK_FREE_RING, threads, perProducer));
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+#include "IdleManager.h"
+#include "ObjectPool.h"
+#include "FlowBench.h"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Checkout and return cycles at 1, 4 and 8 threads against a pool of 8 objects, so the wider runs
+// compete for them: IdleManager's get() against ObjectPool's acquire().
+namespace {
+    struct Connection {
+        uint64_t uses = 0;
+    };
+
+    template<class Cycle>
+    double run(const size_t &threads, const size_t &cycles, Cycle cycle) {
+        std::vector<std::thread> workers;
+        return FlowBench::seconds([&] {
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&] {
+                    for (size_t i = 0; i < cycles / threads; ++i) {
+                        cycle();
+                    }
+                });
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        });
+    }
+}
+
+int main(int argc, char **argv) {
+    constexpr size_t objects = 8;
+    const size_t cycles = FlowBench::scaled(2000000, FlowBench::scale(argc, argv));
+    for (const size_t threads: {1, 4, 8}) {
+        const std::string suffix = ", " + std::to_string(threads) + " threads";
+        IdleManager<Connection> manager;
+        for (size_t i = 0; i < objects; ++i) {
+            manager.add(std::make_shared<Connection>());
+        }
+        FlowBench::report("IdleManager" + suffix, cycles, run(threads, cycles, [&] {
+            const auto object = manager.get();
+            ++object->object->uses;
+        }));
+        ObjectPool<Connection> pool(objects);
+        FlowBench::report("ObjectPool" + suffix, cycles, run(threads, cycles, [&] {
+            const auto handle = pool.acquire();
+            ++handle->uses;
+        }));
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include "PriorityScheduler.h"
+#include "FlowBench.h"
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+// High-contention enqueue/dequeue throughput of PriorityScheduler against the mutex-guarded
+// std::priority_queue PriorityWorkerPool used before, and the time tasks of each priority class spend
+// queued (p50/p99) while producers and consumers run flat out.
+namespace {
+    constexpr size_t classes = 4;
+
+    struct Entry {
+        int64_t queuedAt = 0;
+        size_t priority = 0;
+
+        bool operator<(const Entry &other) const {
+            return priority < other.priority;
+        }
+    };
+
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                FlowBench::Clock::now().time_since_epoch()).count();
+    }
+
+    struct LockedHeap {
+        void push(const Entry &entry, const size_t &) {
+            std::lock_guard<std::mutex> guard(mutex);
+            heap.push(entry);
+        }
+
+        bool tryPop(Entry &entry) {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (heap.empty()) {
+                return false;
+            }
+            entry = heap.top();
+            heap.pop();
+            return true;
+        }
+
+        std::mutex mutex;
+        std::priority_queue<Entry> heap;
+    };
+
+    template<class Store>
+    void run(const std::string &name, Store &store, const size_t &threads, const size_t &perProducer) {
+        std::atomic_size_t remaining = {threads * perProducer};
+        std::vector<std::array<std::vector<int64_t>, classes>> waits(threads);
+        std::vector<std::thread> workers;
+        const double elapsed = FlowBench::seconds([&] {
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&, t] {
+                    for (size_t i = 0; i < perProducer; ++i) {
+                        const size_t priority = (i + t) % classes;
+                        store.push(Entry{now(), priority}, priority);
+                    }
+                });
+                workers.emplace_back([&, t] {
+                    Entry entry;
+                    while (remaining.load(std::memory_order_relaxed) > 0) {
+                        if (store.tryPop(entry)) {
+                            waits[t][entry.priority].push_back(now() - entry.queuedAt);
+                            remaining.fetch_sub(1, std::memory_order_relaxed);
+                        }
+                    }
+                });
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        });
+        const std::string label = name + " " + std::to_string(threads) + "P/" + std::to_string(threads) + "C";
+        FlowBench::report(label, threads * perProducer, elapsed);
+        for (size_t priority = classes; priority-- > 0;) {
+            std::vector<int64_t> merged;
+            for (auto &perThread: waits) {
+                merged.insert(merged.end(), perThread[priority].begin(), perThread[priority].end());
+            }
+            const int64_t p50 = FlowBench::percentile(merged, 0.5);
+            const int64_t p99 = FlowBench::percentile(merged, 0.99);
+            std::cout << "  priority " << priority << " queued p50 " << p50 << " ns, p99 " << p99 << " ns"
+                      << std::endl;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t total = FlowBench::scaled(400000, FlowBench::scale(argc, argv));
+    for (const size_t threads: {1, 4, 8}) {
+        LockedHeap heap;
+        run("locked heap", heap, threads, total / threads);
+        PriorityScheduler<Entry> scheduler(classes, 1024);
+        run("PriorityScheduler", scheduler, threads, total / threads);
+    }
+    return 0;
+}
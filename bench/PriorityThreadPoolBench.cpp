@@ -0,0 +1,60 @@
+#include "FlowLog.h"
+#include "PriorityThreadPool.h"
+#include "FlowBench.h"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Latency to start (p50/p99) of urgent functions submitted while the pool is saturated with long
+// low-priority jobs: a detached thread per function, the persistent pool, and the persistent pool with
+// long jobs reaching yieldIfHigherPriorityPending() preemption points.
+namespace {
+    using std::chrono::microseconds;
+
+    int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                FlowBench::Clock::now().time_since_epoch()).count();
+    }
+
+    void spinFor(const microseconds &duration, const bool &preemptible) {
+        const auto end = FlowBench::Clock::now() + duration;
+        while (FlowBench::Clock::now() < end) {
+            if (preemptible) {
+                PriorityThreadPool::yieldIfHigherPriorityPending();
+            }
+        }
+    }
+
+    void run(const std::string &name, const bool &persistent, const bool &preemptible, const size_t &urgentCount) {
+        constexpr size_t threads = 2;
+        const microseconds jobLength(200);
+        const microseconds interval(100);
+        PriorityThreadPool pool(threads, persistent);
+        const size_t background = urgentCount * interval.count() * threads / jobLength.count() + threads;
+        for (size_t i = 0; i < background; ++i) {
+            pool.addFunction(InlineTask([jobLength, preemptible] { spinFor(jobLength, preemptible); }), 0);
+        }
+        pool.start();
+        std::vector<int64_t> latencies(urgentCount);
+        for (size_t i = 0; i < urgentCount; ++i) {
+            const int64_t queuedAt = now();
+            pool.addFunction(InlineTask([&latencies, i, queuedAt] { latencies[i] = now() - queuedAt; }), 10);
+            pool.start();
+            std::this_thread::sleep_for(interval);
+        }
+        pool.join();
+        const int64_t p50 = FlowBench::percentile(latencies, 0.5);
+        const int64_t p99 = FlowBench::percentile(latencies, 0.99);
+        std::cout << name << ": urgent start p50 " << p50 / 1000.0 << " us, p99 " << p99 / 1000.0 << " us"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t urgentCount = FlowBench::scaled(2000, FlowBench::scale(argc, argv));
+    run("thread per function", false, false, urgentCount);
+    run("persistent", true, false, urgentCount);
+    run("persistent, preemption points", true, true, urgentCount);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "ReaderWriterLock.h"
+#include "SeqLock.h"
+#include "FlowBench.h"
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Read side cost of a small shared config at 1, 8 and 64 reader threads, with one writer updating it
+// every 100us: std::mutex, std::shared_mutex, ReaderWriterLock and SeqLock.
+namespace {
+    struct Config {
+        uint64_t limit = 0;
+        uint64_t timeout = 0;
+    };
+
+    template<class Read, class Write>
+    double readers(const size_t &threads, const size_t &reads, Read read, Write write) {
+        std::atomic_bool done = {false};
+        std::thread writer([&] {
+            uint64_t value = 0;
+            while (!done) {
+                write(++value);
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+        std::atomic_uint64_t sink = {0};
+        std::vector<std::thread> workers;
+        const double elapsed = FlowBench::seconds([&] {
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&] {
+                    uint64_t sum = 0;
+                    for (size_t i = 0; i < reads / threads; ++i) {
+                        sum += read();
+                    }
+                    sink += sum;
+                });
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        });
+        done = true;
+        writer.join();
+        return elapsed;
+    }
+
+    template<class Mutex, class ReadGuard>
+    void locked(const std::string &name, const size_t &threads, const size_t &reads) {
+        Mutex mutex;
+        Config config;
+        FlowBench::report(name, reads, readers(threads, reads, [&] {
+            const ReadGuard guard(mutex);
+            return config.limit + config.timeout;
+        }, [&](const uint64_t &value) {
+            const std::lock_guard<Mutex> guard(mutex);
+            config.limit = value;
+            config.timeout = value;
+        }));
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t reads = FlowBench::scaled(8000000, FlowBench::scale(argc, argv));
+    for (const size_t threads: {1, 8, 64}) {
+        const std::string suffix = ", " + std::to_string(threads) + " readers";
+        locked<std::mutex, std::lock_guard<std::mutex>>("std::mutex" + suffix, threads, reads);
+        locked<std::shared_mutex, std::shared_lock<std::shared_mutex>>("std::shared_mutex" + suffix, threads,
+                                                                        reads);
+        locked<ReaderWriterLock, std::shared_lock<ReaderWriterLock>>("ReaderWriterLock" + suffix, threads, reads);
+        SeqLock<Config> snapshot;
+        FlowBench::report("SeqLock" + suffix, reads, readers(threads, reads, [&] {
+            const Config config = snapshot.load();
+            return config.limit + config.timeout;
+        }, [&](const uint64_t &value) {
+            snapshot.store(Config{value, value});
+        }));
+    }
+    return 0;
+}
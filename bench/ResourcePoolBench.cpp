@@ -0,0 +1,72 @@
+#include "IdleManager.h"
+#include "ObjectPool.h"
+#include "ResourcePool.h"
+#include "FlowBench.h"
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Checkout and return under contention: 1 to 16 threads sharing 4 connections through IdleManager,
+// ResourcePool with and without a validator, and the lock-free ObjectPool for reference.
+namespace {
+    struct Connection {
+        uint64_t uses = 0;
+        bool healthy = true;
+    };
+
+    template<class Cycle>
+    double run(const size_t &threads, const size_t &cycles, Cycle cycle) {
+        std::vector<std::thread> workers;
+        return FlowBench::seconds([&] {
+            for (size_t t = 0; t < threads; ++t) {
+                workers.emplace_back([&] {
+                    for (size_t i = 0; i < cycles / threads; ++i) {
+                        cycle();
+                    }
+                });
+            }
+            for (auto &worker: workers) {
+                worker.join();
+            }
+        });
+    }
+}
+
+int main(int argc, char **argv) {
+    constexpr size_t connections = 4;
+    const size_t cycles = FlowBench::scaled(1000000, FlowBench::scale(argc, argv));
+    for (const size_t threads: {1, 4, 16}) {
+        const std::string suffix = ", " + std::to_string(threads) + " threads";
+        IdleManager<Connection> manager;
+        for (size_t i = 0; i < connections; ++i) {
+            manager.add(std::make_shared<Connection>());
+        }
+        FlowBench::report("IdleManager" + suffix, cycles, run(threads, cycles, [&] {
+            const auto object = manager.get();
+            ++object->object->uses;
+        }));
+        ResourcePool<Connection> plain(connections, [] {
+            return Connection();
+        });
+        FlowBench::report("ResourcePool" + suffix, cycles, run(threads, cycles, [&] {
+            const auto handle = plain.acquire();
+            ++handle->uses;
+        }));
+        ResourcePool<Connection> validated(connections, [] {
+            return Connection();
+        }, [](Connection &connection) {
+            return connection.healthy;
+        });
+        FlowBench::report("ResourcePool validated" + suffix, cycles, run(threads, cycles, [&] {
+            const auto handle = validated.acquire();
+            ++handle->uses;
+        }));
+        ObjectPool<Connection> lockFree(connections);
+        FlowBench::report("ObjectPool" + suffix, cycles, run(threads, cycles, [&] {
+            const auto handle = lockFree.acquire();
+            ++handle->uses;
+        }));
+    }
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "FlowLog.h"
+#include "WorkerPool.h"
+#include "FlowBench.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+
+// Per-task overhead of WorkerPool for empty tasks: one wake per task against batch drain, with and
+// without a spin window before workers sleep, on both task stores.
+namespace {
+    double run(const TaskStore &store, const bool &batchDrain, const std::chrono::nanoseconds &spinWindow,
+               const size_t &workers, const size_t &count) {
+        WorkerPool pool(workers, store, count);
+        pool.setBatchDrain(batchDrain);
+        pool.setSpinWindow(spinWindow);
+        std::atomic_size_t runs = {0};
+        pool.start();
+        return FlowBench::seconds([&] {
+            for (size_t i = 0; i < count; ++i) {
+                pool.addTask(InlineTask([&runs] { runs.fetch_add(1, std::memory_order_relaxed); }));
+            }
+            pool.start();
+            pool.wait();
+        });
+    }
+}
+
+int main(int argc, char **argv) {
+    const size_t count = FlowBench::scaled(200000, FlowBench::scale(argc, argv));
+    for (const size_t workers: {1, 4}) {
+        for (const TaskStore store: {TaskStore::LOCKED_QUEUE, TaskStore::LOCK_FREE_RING}) {
+            const std::string prefix = std::to_string(workers) + (workers == 1 ? " worker, " : " workers, ") +
+                                       (store == TaskStore::LOCKED_QUEUE ? "locked queue, " : "ring, ");
+            FlowBench::report(prefix + "wake per task", count,
+                              run(store, false, std::chrono::nanoseconds::zero(), workers, count));
+            FlowBench::report(prefix + "batch drain", count,
+                              run(store, true, std::chrono::nanoseconds::zero(), workers, count));
+            FlowBench::report(prefix + "batch drain, 20us spin", count,
+                              run(store, true, std::chrono::microseconds(20), workers, count));
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+#include "FlowLog.h"
+#include "WorkerPool.h"
+#include "ThreadPool.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    // A single-worker pool whose worker is held busy, with capacity queued tasks behind it.
+    struct FullPool {
+        FullPool(const size_t &capacity, const AdmissionPolicy &policy) : pool(1) {
+            pool.setAdmission(capacity, policy);
+            pool.addTask(InlineTask([this] {
+                started = true;
+                while (!released) {
+                    std::this_thread::yield();
+                }
+            }));
+            pool.start();
+            FLOW_CHECK(FlowTest::waitFor([this] { return started.load(); }));
+            for (size_t i = 0; i < capacity; ++i) {
+                FLOW_CHECK(pool.addTask(task(static_cast<int>(i))) == SubmitResult::ACCEPTED);
+            }
+        }
+
+        ~FullPool() {
+            release();
+        }
+
+        InlineTask task(const int &id) {
+            return InlineTask([this, id] {
+                std::lock_guard<std::mutex> guard(ranMutex);
+                ran.push_back(id);
+            });
+        }
+
+        void release() {
+            released = true;
+            pool.start();
+            pool.wait();
+        }
+
+        std::atomic_bool started = {false};
+        std::atomic_bool released = {false};
+        std::mutex ranMutex;
+        std::vector<int> ran;
+        WorkerPool pool;
+    };
+
+    void rejectsWhenFull() {
+        FullPool full(2, AdmissionPolicy::REJECT);
+        FLOW_CHECK(full.pool.addTask(full.task(2)) == SubmitResult::REJECTED);
+        FLOW_CHECK(full.pool.getRejectedCount() == 1);
+        FLOW_CHECK(full.pool.getHighWaterMark() == 2);
+        full.release();
+        FLOW_CHECK((full.ran == std::vector<int>{0, 1}));
+    }
+
+    void dropsOldest() {
+        FullPool full(2, AdmissionPolicy::DROP_OLDEST);
+        FLOW_CHECK(full.pool.addTask(full.task(2)) == SubmitResult::ACCEPTED);
+        FLOW_CHECK(full.pool.addTask(full.task(3)) == SubmitResult::ACCEPTED);
+        FLOW_CHECK(full.pool.getShedCount() == 2);
+        full.release();
+        FLOW_CHECK((full.ran == std::vector<int>{2, 3}));
+    }
+
+    void runsInCaller() {
+        FullPool full(1, AdmissionPolicy::CALLER_RUNS);
+        std::thread::id ranOn;
+        FLOW_CHECK(full.pool.addTask(InlineTask([&ranOn] { ranOn = std::this_thread::get_id(); })) ==
+                   SubmitResult::RAN_IN_CALLER);
+        FLOW_CHECK(ranOn == std::this_thread::get_id());
+    }
+
+    void blocksUntilThereIsRoom() {
+        FullPool full(1, AdmissionPolicy::BLOCK);
+        std::atomic_bool submitted = {false};
+        std::thread submitter([&] {
+            full.pool.addTask(full.task(1));
+            submitted = true;
+        });
+        std::this_thread::sleep_for(milliseconds(20));
+        FLOW_CHECK(!submitted);
+        full.release();
+        submitter.join();
+        full.pool.wait();
+        FLOW_CHECK((full.ran == std::vector<int>{0, 1}));
+    }
+
+    // trySubmit never blocks or runs the task on the caller, whatever the policy.
+    void trySubmitRejects() {
+        for (const auto policy: {AdmissionPolicy::BLOCK, AdmissionPolicy::CALLER_RUNS}) {
+            FullPool full(1, policy);
+            FLOW_CHECK(full.pool.trySubmit(full.task(1)) == SubmitResult::REJECTED);
+        }
+    }
+
+    // A full ThreadPool first starts what it can; it only rejects once every thread is busy.
+    void threadPoolRejects() {
+        ThreadPool pool(1);
+        pool.setAdmission(2, AdmissionPolicy::REJECT);
+        std::atomic_bool started = {false};
+        std::atomic_bool released = {false};
+        pool.addFunction(InlineTask([&] {
+            started = true;
+            while (!released) {
+                std::this_thread::yield();
+            }
+        }));
+        pool.start();
+        FLOW_CHECK(FlowTest::waitFor([&] { return started.load(); }));
+        std::atomic_int runs = {0};
+        for (int i = 0; i < 2; ++i) {
+            FLOW_CHECK(pool.addFunction(InlineTask([&runs] { ++runs; })) == SubmitResult::ACCEPTED);
+        }
+        FLOW_CHECK(pool.addFunction(InlineTask([&runs] { ++runs; })) == SubmitResult::REJECTED);
+        released = true;
+        pool.join();
+        FLOW_CHECK(runs == 2);
+    }
+}
+
+int main() {
+    rejectsWhenFull();
+    dropsOldest();
+    runsInCaller();
+    blocksUntilThereIsRoom();
+    trySubmitRejects();
+    threadPoolRejects();
+    return FlowTest::result();
+}
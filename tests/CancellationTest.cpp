@@ -0,0 +1,109 @@
+#include "FlowLog.h"
+#include "WorkerPool.h"
+#include "CancellationToken.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    void tokensShareTheFlag() {
+        const CancellationToken never;
+        FLOW_CHECK(!never.canBeCancelled());
+        FLOW_CHECK(!never.isCancelled());
+        const auto token = CancellationToken::create();
+        const CancellationToken copy = token;
+        FLOW_CHECK(copy.canBeCancelled());
+        token.cancel();
+        FLOW_CHECK(copy.isCancelled());
+        FLOW_CHECK(!CancellationToken::current().canBeCancelled());
+        {
+            const CancellationScope scope(token);
+            FLOW_CHECK(CancellationToken::current().isCancelled());
+        }
+        FLOW_CHECK(!CancellationToken::current().canBeCancelled());
+    }
+
+    // Cancelled and expired tasks are shed when dequeued; the rest run.
+    void shedsCancelledAndExpired() {
+        WorkerPool pool(2);
+        const auto cancelled = CancellationToken::create();
+        cancelled.cancel();
+        const auto expired = CancellableTask::Clock::now() - milliseconds(1);
+        std::atomic_int runs = {0};
+        for (int i = 0; i < 30; ++i) {
+            auto task = InlineTask([&runs] { ++runs; });
+            if (i % 3 == 0) {
+                pool.addTask(std::move(task), cancelled);
+            } else if (i % 3 == 1) {
+                pool.addTask(std::move(task), expired);
+            } else {
+                pool.addTask(std::move(task));
+            }
+        }
+        pool.start();
+        pool.wait();
+        FLOW_CHECK(runs == 10);
+        FLOW_CHECK(pool.getShedCount() == 20);
+        FLOW_CHECK(pool.getExecutedCount() == 10);
+    }
+
+    // A running task sees its token as current() and can stop early when it is cancelled.
+    void runningTaskPollsItsToken() {
+        WorkerPool pool(1);
+        const auto token = CancellationToken::create();
+        std::atomic_bool started = {false};
+        std::atomic_bool stoppedEarly = {false};
+        pool.addTask(InlineTask([&] {
+            started = true;
+            while (!CancellationToken::current().isCancelled()) {
+                std::this_thread::yield();
+            }
+            stoppedEarly = true;
+        }), token);
+        pool.start();
+        FLOW_CHECK(FlowTest::waitFor([&] { return started.load(); }));
+        token.cancel();
+        pool.wait();
+        FLOW_CHECK(stoppedEarly);
+        // The worker's next task does not inherit the token.
+        std::atomic_bool inherited = {true};
+        pool.addTask(InlineTask([&] { inherited = CancellationToken::current().canBeCancelled(); }));
+        pool.start();
+        pool.wait();
+        FLOW_CHECK(!inherited);
+    }
+
+    void cancelQueuedShedsBacklog() {
+        WorkerPool pool(1);
+        std::atomic_bool started = {false};
+        std::atomic_bool released = {false};
+        std::atomic_int runs = {0};
+        pool.addTask(InlineTask([&] {
+            started = true;
+            while (!released) {
+                std::this_thread::yield();
+            }
+        }));
+        pool.start();
+        FLOW_CHECK(FlowTest::waitFor([&] { return started.load(); }));
+        for (int i = 0; i < 10; ++i) {
+            pool.addTask(InlineTask([&runs] { ++runs; }));
+        }
+        FLOW_CHECK(pool.cancelQueued() == 10);
+        released = true;
+        pool.wait();
+        FLOW_CHECK(runs == 0);
+        FLOW_CHECK(pool.getShedCount() == 10);
+    }
+}
+
+int main() {
+    tokensShareTheFlag();
+    shedsCancelledAndExpired();
+    runningTaskPollsItsToken();
+    cancelQueuedShedsBacklog();
+    return FlowTest::result();
+}
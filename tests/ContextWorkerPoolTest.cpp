@@ -0,0 +1,70 @@
+#include "FlowLog.h"
+#include "Worker.h"
+#include "ContextWorkerPool.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace {
+    struct Counted {
+        static inline std::atomic_int copies = {0};
+
+        Counted() = default;
+
+        Counted(const Counted &other) : handled(other.handled) {
+            ++copies;
+        }
+
+        Counted &operator=(const Counted &other) {
+            handled = other.handled;
+            ++copies;
+            return *this;
+        }
+
+        int handled = 0;
+        std::vector<int> order;
+    };
+
+    // Tasks see the worker's own context, so state written by one task is there for the next.
+    void passesContextByReference() {
+        auto worker = std::make_shared<ContextWorker<Counted>>(0);
+        {
+            ContextWorkerPool<Counted> pool({worker});
+            for (int i = 0; i < 100; ++i) {
+                pool.addTask(ContextTask<Counted>([](Counted &context) { ++context.handled; }));
+            }
+            pool.start();
+            pool.wait();
+        }
+        FLOW_CHECK(worker->context.handled == 100);
+        FLOW_CHECK(Counted::copies == 0);
+    }
+
+    // A batch is one queue entry that a single worker runs in order.
+    void runsBatchInOrder() {
+        auto worker = std::make_shared<ContextWorker<Counted>>(0);
+        {
+            ContextWorkerPool<Counted> pool({worker});
+            std::vector<ContextTask<Counted>> batch;
+            for (int i = 0; i < 50; ++i) {
+                batch.emplace_back([i](Counted &context) { context.order.push_back(i); });
+            }
+            FLOW_CHECK(pool.addTasks(batch) == SubmitResult::ACCEPTED);
+            FLOW_CHECK(pool.getHighWaterMark() == 1);
+            pool.start();
+            pool.wait();
+        }
+        bool ordered = worker->context.order.size() == 50;
+        for (size_t i = 0; ordered && i < worker->context.order.size(); ++i) {
+            ordered = worker->context.order[i] == static_cast<int>(i);
+        }
+        FLOW_CHECK(ordered);
+    }
+}
+
+int main() {
+    passesContextByReference();
+    runsBatchInOrder();
+    return FlowTest::result();
+}
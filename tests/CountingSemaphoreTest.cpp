@@ -0,0 +1,90 @@
+#include "CountingSemaphore.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    void countsPermits() {
+        CountingSemaphore semaphore(2);
+        FLOW_CHECK(semaphore.available() == 2);
+        FLOW_CHECK(semaphore.try_acquire());
+        FLOW_CHECK(semaphore.try_acquire());
+        FLOW_CHECK(!semaphore.try_acquire());
+        semaphore.release(3);
+        FLOW_CHECK(semaphore.available() == 3);
+        for (int i = 0; i < 3; ++i) {
+            FLOW_CHECK(semaphore.try_acquire());
+        }
+        FLOW_CHECK(!semaphore.try_acquire());
+    }
+
+    void timedAcquireExpires() {
+        for (const auto window: {std::chrono::microseconds(0), std::chrono::microseconds(500)}) {
+            CountingSemaphore semaphore(0, window);
+            const auto start = std::chrono::steady_clock::now();
+            FLOW_CHECK(!semaphore.try_acquire_for(milliseconds(10)));
+            FLOW_CHECK(std::chrono::steady_clock::now() - start >= milliseconds(10));
+            semaphore.release();
+            FLOW_CHECK(semaphore.try_acquire_until(std::chrono::steady_clock::now() + milliseconds(10)));
+        }
+    }
+
+    // One release(n) wakes n sleepers.
+    void releaseWakesSleepers() {
+        CountingSemaphore semaphore(0, std::chrono::nanoseconds::zero());
+        std::atomic_int woken = {0};
+        std::vector<std::thread> sleepers;
+        for (int i = 0; i < 4; ++i) {
+            sleepers.emplace_back([&] {
+                semaphore.acquire();
+                ++woken;
+            });
+        }
+        std::this_thread::sleep_for(milliseconds(10));
+        FLOW_CHECK(woken == 0);
+        semaphore.release(4);
+        for (auto &sleeper: sleepers) {
+            sleeper.join();
+        }
+        FLOW_CHECK(woken == 4);
+        FLOW_CHECK(semaphore.available() == 0);
+    }
+
+    // Every permit released by the producers is acquired exactly once.
+    void producersAndConsumers() {
+        CountingSemaphore semaphore(0);
+        constexpr int perThread = 20000;
+        std::atomic_int acquired = {0};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 3; ++i) {
+            threads.emplace_back([&] {
+                for (int j = 0; j < perThread; ++j) {
+                    semaphore.release();
+                }
+            });
+            threads.emplace_back([&] {
+                for (int j = 0; j < perThread; ++j) {
+                    semaphore.acquire();
+                    ++acquired;
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        FLOW_CHECK(acquired == 3 * perThread);
+        FLOW_CHECK(semaphore.available() == 0);
+    }
+}
+
+int main() {
+    countsPermits();
+    timedAcquireExpires();
+    releaseWakesSleepers();
+    producersAndConsumers();
+    return FlowTest::result();
+}
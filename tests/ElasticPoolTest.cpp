@@ -0,0 +1,76 @@
+#include "FlowLog.h"
+#include "WorkerPool.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    // Blocked tasks keep every worker busy, so the backlog makes the pool grow to its maximum; once
+    // they finish the extra workers time out and retire down to the minimum.
+    void growsAndRetires() {
+        WorkerPool pool(1);
+        pool.setElastic({1, 4, milliseconds(20), 2, milliseconds(1)});
+        std::atomic_bool released = {false};
+        std::atomic_int running = {0};
+        std::atomic_int finished = {0};
+        for (int i = 0; i < 8; ++i) {
+            pool.addTask(InlineTask([&] {
+                ++running;
+                while (!released) {
+                    std::this_thread::yield();
+                }
+                --running;
+                ++finished;
+            }));
+        }
+        pool.start();
+        FLOW_CHECK(FlowTest::waitFor([&] {
+            pool.start();
+            return running == 4;
+        }));
+        FLOW_CHECK(pool.getWorkerCount() == 4);
+        FLOW_CHECK(pool.getSpawnCount() == 3);
+        released = true;
+        pool.wait();
+        FLOW_CHECK(finished == 8);
+        FLOW_CHECK(FlowTest::waitFor([&] { return pool.getWorkerCount() == 1; }));
+        FLOW_CHECK(pool.getRetirementCount() == 3);
+        // The remaining worker still takes work.
+        std::atomic_bool ran = {false};
+        pool.addTask(InlineTask([&ran] { ran = true; }));
+        pool.start();
+        pool.wait();
+        FLOW_CHECK(ran);
+    }
+
+    // Short tasks in quick rounds with batch drain: growth and retirement never lose a task.
+    void churnKeepsEveryTask() {
+        WorkerPool pool(1);
+        pool.setBatchDrain(true);
+        pool.setElastic({1, 3, milliseconds(1), 2, std::chrono::microseconds(10)});
+        pool.start();
+        std::atomic_int runs = {0};
+        for (int round = 0; round < 100; ++round) {
+            for (int i = 0; i < 50; ++i) {
+                pool.addTask(InlineTask([&runs] { ++runs; }));
+            }
+            pool.start();
+            pool.wait();
+            if (round % 25 == 0) {
+                std::this_thread::sleep_for(milliseconds(3));
+            }
+        }
+        FLOW_CHECK(runs == 5000);
+        FLOW_CHECK(pool.getWorkerCount() >= 1);
+        FLOW_CHECK(pool.getWorkerCount() <= 3);
+    }
+}
+
+int main() {
+    growsAndRetires();
+    churnKeepsEveryTask();
+    return FlowTest::result();
+}
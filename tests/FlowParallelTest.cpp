@@ -0,0 +1,89 @@
+#include "FlowParallel.h"
+#include "FlowTest.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    // Every algorithm against its std counterpart, with sizes around the grain boundaries.
+    void matchesSerial(WorkStealingPool &pool) {
+        for (const size_t count: {0ul, 1ul, 5ul, 1000ul, 4097ul, 1000003ul}) {
+            std::vector<long> values(count);
+            std::iota(values.begin(), values.end(), 1);
+            FlowParallel::for_each(pool, values.begin(), values.end(), [](long &value) { value *= 2; });
+            FLOW_CHECK(count == 0 || values.back() == static_cast<long>(count) * 2);
+
+            std::vector<long> transformed(count);
+            FlowParallel::transform(pool, values.begin(), values.end(), transformed.begin(),
+                                    [](const long value) { return value + 1; }, 100);
+            FLOW_CHECK(FlowParallel::reduce(pool, transformed.begin(), transformed.end(), 0L) ==
+                       std::accumulate(transformed.begin(), transformed.end(), 0L));
+
+            std::vector<long> scanned(count);
+            std::vector<long> expected(count);
+            FlowParallel::inclusive_scan(pool, transformed.begin(), transformed.end(), scanned.begin(),
+                                         std::plus<>{}, 333);
+            std::inclusive_scan(transformed.begin(), transformed.end(), expected.begin());
+            FLOW_CHECK(scanned == expected);
+
+            FlowParallel::exclusive_scan(pool, transformed.begin(), transformed.end(), scanned.begin(), 5L,
+                                         std::plus<>{}, 333);
+            std::exclusive_scan(transformed.begin(), transformed.end(), expected.begin(), 5L);
+            FLOW_CHECK(scanned == expected);
+            // In place.
+            FlowParallel::exclusive_scan(pool, transformed.begin(), transformed.end(), transformed.begin(), 5L,
+                                         std::plus<>{}, 333);
+            FLOW_CHECK(transformed == expected);
+
+            std::mt19937 random(static_cast<unsigned>(count));
+            std::vector<int> toSort(count);
+            for (auto &value: toSort) {
+                value = static_cast<int>(random());
+            }
+            auto sorted = toSort;
+            std::sort(sorted.begin(), sorted.end());
+            FlowParallel::sort(pool, toSort.begin(), toSort.end(), std::less<>{}, 777);
+            FLOW_CHECK(toSort == sorted);
+        }
+    }
+
+    // Partial results are combined in range order, so a non-commutative operation works.
+    void reduceKeepsOrder(WorkStealingPool &pool) {
+        std::vector<std::string> digits(3000);
+        for (size_t i = 0; i < digits.size(); ++i) {
+            digits[i] = std::to_string(i % 10);
+        }
+        FLOW_CHECK(FlowParallel::reduce(pool, digits.begin(), digits.end(), std::string(">"), std::plus<>{}, 7) ==
+                   std::accumulate(digits.begin(), digits.end(), std::string(">")));
+    }
+
+    void nestsAndRethrows(WorkStealingPool &pool) {
+        std::vector<int> outer(64);
+        FlowParallel::for_each(pool, outer.begin(), outer.end(), [&](int &value) {
+            std::vector<int> inner(5000, 1);
+            value = FlowParallel::reduce(pool, inner.begin(), inner.end(), 0, std::plus<>{}, 100);
+        }, 1);
+        FLOW_CHECK(std::accumulate(outer.begin(), outer.end(), 0) == 64 * 5000);
+        bool caught = false;
+        try {
+            std::vector<int> values(100000);
+            FlowParallel::for_each(pool, values.begin(), values.end(), [](int &) {
+                throw std::runtime_error("thrown");
+            });
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+        FLOW_CHECK(caught);
+    }
+}
+
+int main() {
+    WorkStealingPool pool(4);
+    matchesSerial(pool);
+    reduceKeepsOrder(pool);
+    nestsAndRethrows(pool);
+    return FlowTest::result();
+}
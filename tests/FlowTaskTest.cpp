@@ -0,0 +1,186 @@
+#include "FlowLog.h"
+#include "Worker.h"
+#include "WorkerPool.h"
+#include "ContextWorkerPool.h"
+#include "MultiSemaphore.h"
+#include "FlowTask.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    FlowTask<int> twice(const int value) {
+        co_return value * 2;
+    }
+
+    FlowTask<int> onPool(WorkerPool &pool, const int value, std::thread::id *resumedOn) {
+        co_await pool.schedule();
+        *resumedOn = std::this_thread::get_id();
+        co_return co_await twice(value) + 1;
+    }
+
+    FlowTask<void> throws() {
+        throw std::runtime_error("thrown");
+        co_return;
+    }
+
+    // Counts how the co_await pool.schedule() ended: on a worker, or with the pool refusing it.
+    struct Outcome {
+        std::atomic_int resumed = {0};
+        std::atomic_int failed = {0};
+    };
+
+    FlowTask<void> hop(WorkerPool &pool, Outcome &outcome) {
+        try {
+            co_await pool.schedule();
+            ++outcome.resumed;
+        } catch (const std::runtime_error &) {
+            ++outcome.failed;
+        }
+    }
+
+    struct Context {
+        int id = 7;
+    };
+
+    FlowTask<int> contextId(ContextWorkerPool<Context> &pool) {
+        try {
+            Context &context = co_await pool.schedule();
+            co_return context.id;
+        } catch (const std::runtime_error &) {
+            co_return -1;
+        }
+    }
+
+    // Occupies a single worker until released, so later submissions stay queued.
+    struct Blocker {
+        std::atomic_bool started = {false};
+        std::atomic_bool released = {false};
+
+        InlineTask task() {
+            return InlineTask([this] {
+                started = true;
+                while (!released) {
+                    std::this_thread::yield();
+                }
+            });
+        }
+    };
+
+    void resumesOnWorker() {
+        WorkerPool pool(2);
+        for (int i = 0; i < 200; ++i) {
+            std::thread::id resumedOn;
+            FLOW_CHECK(FlowCoroutine::syncWait(onPool(pool, i, &resumedOn)) == i * 2 + 1);
+            FLOW_CHECK(resumedOn != std::this_thread::get_id());
+        }
+    }
+
+    void propagatesExceptions() {
+        bool caught = false;
+        try {
+            FlowCoroutine::syncWait(throws());
+        } catch (const std::runtime_error &) {
+            caught = true;
+        }
+        FLOW_CHECK(caught);
+    }
+
+    void rejectedScheduleThrows() {
+        WorkerPool pool(1);
+        pool.setAdmission(1, AdmissionPolicy::REJECT);
+        Blocker blocker;
+        pool.addTask(blocker.task());
+        pool.start();
+        FLOW_CHECK(FlowTest::waitFor([&] { return blocker.started.load(); }));
+        pool.addTask(InlineTask([] {}));
+        Outcome outcome;
+        FlowCoroutine::syncWait(hop(pool, outcome));
+        FLOW_CHECK(outcome.failed == 1);
+        FLOW_CHECK(outcome.resumed == 0);
+        blocker.released = true;
+        pool.wait();
+    }
+
+    void shedScheduleThrows() {
+        WorkerPool pool(1);
+        pool.setAdmission(1, AdmissionPolicy::DROP_OLDEST);
+        Blocker blocker;
+        pool.addTask(blocker.task());
+        pool.start();
+        FLOW_CHECK(FlowTest::waitFor([&] { return blocker.started.load(); }));
+        Outcome outcome;
+        FlowCoroutine::spawn(hop(pool, outcome));
+        FLOW_CHECK(outcome.failed == 0);
+        // Full queue: the coroutine's resume task is the oldest and gets dropped.
+        pool.addTask(InlineTask([] {}));
+        FLOW_CHECK(outcome.failed == 1);
+        blocker.released = true;
+        pool.wait();
+        FLOW_CHECK(outcome.resumed == 0);
+    }
+
+    void stopFailsQueuedCoroutines() {
+        Outcome outcome;
+        Blocker blocker;
+        {
+            WorkerPool pool(1);
+            pool.addTask(blocker.task());
+            pool.start();
+            FLOW_CHECK(FlowTest::waitFor([&] { return blocker.started.load(); }));
+            for (int i = 0; i < 5; ++i) {
+                FlowCoroutine::spawn(hop(pool, outcome));
+            }
+            pool.stop();
+            blocker.released = true;
+        }
+        FLOW_CHECK(outcome.failed == 5);
+        FLOW_CHECK(outcome.resumed == 0);
+    }
+
+    void contextPoolSchedule() {
+        ContextWorkerPool<Context> pool(1);
+        pool.setAdmission(1, AdmissionPolicy::REJECT);
+        Blocker blocker;
+        pool.addTask(ContextTask<Context>([&](Context &) {
+            blocker.task()();
+        }));
+        pool.start();
+        FLOW_CHECK(FlowTest::waitFor([&] { return blocker.started.load(); }));
+        pool.addTask(ContextTask<Context>([](Context &) {}));
+        FLOW_CHECK(FlowCoroutine::syncWait(contextId(pool)) == -1);
+        blocker.released = true;
+        pool.wait();
+        FLOW_CHECK(FlowCoroutine::syncWait(contextId(pool)) == 7);
+    }
+
+    void semaphoreResumesWaiters() {
+        MultiSemaphore semaphore;
+        std::atomic_int passed = {0};
+        auto waiter = [&]() -> FlowTask<void> {
+            co_await semaphore.waitAsync();
+            ++passed;
+        };
+        semaphore.addLock();
+        semaphore.addLock();
+        FlowCoroutine::spawn(waiter());
+        FlowCoroutine::spawn(waiter());
+        FLOW_CHECK(passed == 0);
+        semaphore.unlock();
+        FLOW_CHECK(passed == 0);
+        semaphore.unlock();
+        FLOW_CHECK(passed == 2);
+    }
+}
+
+int main() {
+    resumesOnWorker();
+    propagatesExceptions();
+    rejectedScheduleThrows();
+    shedScheduleThrows();
+    stopFailsQueuedCoroutines();
+    contextPoolSchedule();
+    semaphoreResumesWaiters();
+    return FlowTest::result();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+// Just enough for the tests to run without a framework: FLOW_CHECK reports a failed condition and
+// FlowTest::result() turns any failure into a nonzero exit code for ctest.
+namespace FlowTest {
+    inline std::atomic_int &failures() {
+        static std::atomic_int count = {0};
+        return count;
+    }
+
+    inline void check(const bool &passed, const char *condition, const char *file, const int &line) {
+        if (!passed) {
+            ++failures();
+            std::cerr << file << ":" << line << ": check failed: " << condition << std::endl;
+        }
+    }
+
+    // Spins until predicate holds; false if it still does not after timeout.
+    template<class Predicate>
+    bool waitFor(Predicate predicate, const std::chrono::milliseconds &timeout = std::chrono::seconds(5)) {
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!predicate()) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return false;
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    inline int result() {
+        if (failures() != 0) {
+            std::cerr << failures() << " check(s) failed" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+}
+
+#define FLOW_CHECK(condition) FlowTest::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
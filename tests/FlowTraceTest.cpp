@@ -0,0 +1,120 @@
+#ifndef FLOW_TRACE
+#define FLOW_TRACE
+#endif
+
+#include "FlowTrace.h"
+#include "FlowTest.h"
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    const FlowTrace::ZoneStats *find(const std::vector<FlowTrace::ZoneStats> &stats, const std::string &name) {
+        for (const auto &zone: stats) {
+            if (zone.name == name) {
+                return &zone;
+            }
+        }
+        return nullptr;
+    }
+
+    size_t occurrences(const std::string &text, const std::string &part) {
+        size_t count = 0;
+        for (size_t position = text.find(part); position != std::string::npos;
+             position = text.find(part, position + part.size())) {
+            ++count;
+        }
+        return count;
+    }
+
+    // Threads that already exited still get their zones collected.
+    void aggregatesAcrossThreads() {
+        FlowTrace::Collector::instance().clear();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([] {
+                for (int i = 0; i < 1000; ++i) {
+                    FLOW_TRACE_ZONE("outer");
+                    FLOW_TRACE_ZONE("inner");
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        {
+            FLOW_TRACE_ZONE("sleep");
+            std::this_thread::sleep_for(milliseconds(5));
+        }
+        const auto stats = FlowTrace::summary();
+        const auto *outer = find(stats, "outer");
+        const auto *inner = find(stats, "inner");
+        const auto *sleep = find(stats, "sleep");
+        FLOW_CHECK(outer && outer->count == 4000);
+        FLOW_CHECK(inner && inner->count == 4000);
+        FLOW_CHECK(outer && outer->min <= outer->p50 && outer->p50 <= outer->p99 && outer->p99 <= outer->max);
+        FLOW_CHECK(sleep && sleep->count == 1);
+        // Within the histogram's precision and the TSC calibration.
+        FLOW_CHECK(sleep && sleep->max >= 4000000 && sleep->max < 500000000);
+        FLOW_CHECK(FlowTrace::Collector::instance().getDropped() == 0);
+    }
+
+    void disabledRecordsNothing() {
+        FlowTrace::Collector::instance().clear();
+        FlowTrace::setEnabled(false);
+        {
+            FLOW_TRACE_FUNCTION();
+        }
+        FlowTrace::setEnabled(true);
+        FLOW_CHECK(FlowTrace::summary().empty());
+    }
+
+    void fullBufferDrops() {
+        FlowTrace::Collector::instance().clear();
+        constexpr size_t extra = 100;
+        std::thread producer([] {
+            for (size_t i = 0; i < FlowTrace::ThreadBuffer::capacity + extra; ++i) {
+                FLOW_TRACE_ZONE("flood");
+            }
+        });
+        producer.join();
+        const auto stats = FlowTrace::summary();
+        const auto *flood = find(stats, "flood");
+        FLOW_CHECK(flood && flood->count == FlowTrace::ThreadBuffer::capacity);
+        FLOW_CHECK(FlowTrace::Collector::instance().getDropped() == extra);
+    }
+
+    void writesChromeTrace() {
+        auto &collector = FlowTrace::Collector::instance();
+        collector.clear();
+        collector.setRetainedLimit(3);
+        for (int i = 0; i < 5; ++i) {
+            FLOW_TRACE_ZONE("say \"hi\"");
+        }
+        std::ostringstream out;
+        FlowTrace::writeChromeTrace(out);
+        const std::string json = out.str();
+        FLOW_CHECK(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0) == 0);
+        FLOW_CHECK(json.size() >= 2 && json.compare(json.size() - 2, 2, "]}") == 0);
+        FLOW_CHECK(occurrences(json, "\"ph\":\"X\"") == 3);
+        FLOW_CHECK(occurrences(json, "\"name\":\"say \\\"hi\\\"\"") == 3);
+        // Statistics keep counting past the retained events.
+        const auto stats = FlowTrace::summary();
+        const auto *zone = find(stats, "say \"hi\"");
+        FLOW_CHECK(zone && zone->count == 5);
+        FLOW_CHECK(collector.getDropped() == 2);
+        collector.setRetainedLimit(size_t(1) << 20);
+    }
+}
+
+int main() {
+    aggregatesAcrossThreads();
+    disabledRecordsNothing();
+    fullBufferDrops();
+    writesChromeTrace();
+    return FlowTest::result();
+}
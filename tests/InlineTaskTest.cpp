@@ -0,0 +1,90 @@
+#include "InlineTask.h"
+#include "FlowTest.h"
+#include <array>
+#include <memory>
+
+namespace {
+    // Counts live copies so leaks and double destruction show up.
+    struct Tracked {
+        static inline int alive = 0;
+
+        Tracked() {
+            ++alive;
+        }
+
+        Tracked(const Tracked &) {
+            ++alive;
+        }
+
+        Tracked(Tracked &&) noexcept {
+            ++alive;
+        }
+
+        ~Tracked() {
+            --alive;
+        }
+    };
+
+    void storesSmallCallablesInline() {
+        int *a = nullptr, *b = nullptr, *c = nullptr;
+        auto small = [a, b, c] { return a == b && b == c; };
+        FLOW_CHECK(InlineTask::storedInline<decltype(small)>());
+        std::array<char, 128> big{};
+        auto large = [big] { return big[0]; };
+        FLOW_CHECK(!InlineTask::storedInline<decltype(large)>());
+    }
+
+    void runsInlineAndHeapCallables() {
+        int runs = 0;
+        InlineTask small([&runs] { ++runs; });
+        std::array<int, 32> big{};
+        big[31] = 2;
+        InlineTask large([&runs, big] { runs += big[31]; });
+        small();
+        large();
+        FLOW_CHECK(runs == 3);
+    }
+
+    void movesOnlyCaptures() {
+        auto value = std::make_unique<int>(5);
+        int seen = 0;
+        InlineTask task([value = std::move(value), &seen] { seen = *value; });
+        InlineTask moved(std::move(task));
+        FLOW_CHECK(!task);
+        FLOW_CHECK(moved);
+        moved();
+        FLOW_CHECK(seen == 5);
+    }
+
+    void destroysCapturesOnce() {
+        {
+            InlineTask small([tracked = Tracked()] {});
+            InlineTask moved(std::move(small));
+            FLOW_CHECK(Tracked::alive == 1);
+            moved = nullptr;
+            FLOW_CHECK(Tracked::alive == 0);
+        }
+        {
+            std::array<char, 128> big{};
+            InlineTask large([tracked = Tracked(), big] {});
+            InlineTask other;
+            other = std::move(large);
+            FLOW_CHECK(Tracked::alive == 1);
+        }
+        FLOW_CHECK(Tracked::alive == 0);
+    }
+
+    void returnsResults() {
+        InlineFunction<int(int, int)> add([](int a, int b) { return a + b; });
+        FLOW_CHECK(add(2, 3) == 5);
+    }
+}
+
+int main() {
+    storesSmallCallablesInline();
+    runsInlineAndHeapCallables();
+    movesOnlyCaptures();
+    destroysCapturesOnce();
+    returnsResults();
+    return FlowTest::result();
+}
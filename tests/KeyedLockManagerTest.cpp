@@ -0,0 +1,100 @@
+#include "IdSemaphore.h"
+#include "KeyedLockManager.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    void guardsAndTries() {
+        KeyedLockManager manager(16);
+        {
+            auto first = manager.lock("user-1");
+            FLOW_CHECK(first && manager.isLocked("user-1"));
+            FLOW_CHECK(manager.size() == 1);
+            FLOW_CHECK(!manager.tryLock("user-1"));
+            const auto start = std::chrono::steady_clock::now();
+            FLOW_CHECK(!manager.tryLockFor(std::string("user-1"), milliseconds(10)));
+            FLOW_CHECK(std::chrono::steady_clock::now() - start >= milliseconds(10));
+            auto second = manager.tryLock("user-2");
+            FLOW_CHECK(second && manager.size() == 2);
+            second.unlock();
+            FLOW_CHECK(!manager.isLocked("user-2"));
+        }
+        // Entries go away with their last holder.
+        FLOW_CHECK(manager.size() == 0);
+    }
+
+    void releasedGuardUnlocksLater() {
+        KeyedLockManager manager;
+        auto guard = manager.lock("key");
+        guard.release();
+        FLOW_CHECK(!guard.ownsLock());
+        FLOW_CHECK(manager.isLocked("key"));
+        manager.unlock("key");
+        FLOW_CHECK(!manager.isLocked("key"));
+        FLOW_CHECK(manager.size() == 0);
+    }
+
+    // Non-atomic read-modify-write per key stays exact under the key's lock.
+    void excludesPerKey() {
+        KeyedLockManager manager(4);
+        constexpr int keys = 8;
+        std::vector<long> counters(keys);
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 20000; ++i) {
+                    const int key = (i * 7 + t) % keys;
+                    const auto guard = manager.lock("key" + std::to_string(key));
+                    const long value = counters[key];
+                    if (i % 64 == 0) {
+                        std::this_thread::yield();
+                    }
+                    counters[key] = value + 1;
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        long total = 0;
+        for (const long counter: counters) {
+            total += counter;
+        }
+        FLOW_CHECK(total == 80000);
+        FLOW_CHECK(manager.size() == 0);
+    }
+
+    void idSemaphore() {
+        IdSemaphore ids;
+        ids.lock("a");
+        FLOW_CHECK(!ids.addLock("a"));
+        FLOW_CHECK(ids.isLocked("a"));
+        std::atomic_bool done = {false};
+        std::thread waiter([&] {
+            ids.wait("a");
+            done = true;
+        });
+        std::this_thread::sleep_for(milliseconds(20));
+        FLOW_CHECK(!done);
+        ids.unlock("a");
+        waiter.join();
+        FLOW_CHECK(done);
+        FLOW_CHECK(!ids.isLocked("a"));
+        FLOW_CHECK(ids.addLock("a"));
+        ids.unlock("a");
+    }
+}
+
+int main() {
+    guardsAndTries();
+    releasedGuardUnlocksLater();
+    excludesPerKey();
+    idSemaphore();
+    return FlowTest::result();
+}
@@ -0,0 +1,149 @@
+#include "MPMCQueue.h"
+#include "TaskQueue.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    void roundsCapacityUp() {
+        FLOW_CHECK(MPMCQueue<int>(1).capacity() == 2);
+        FLOW_CHECK(MPMCQueue<int>(100).capacity() == 128);
+        FLOW_CHECK(MPMCQueue<int>(128).capacity() == 128);
+    }
+
+    void fifoUntilFull() {
+        MPMCQueue<int> queue(4);
+        int value = -1;
+        FLOW_CHECK(!queue.tryPop(value));
+        for (int i = 0; i < 4; ++i) {
+            FLOW_CHECK(queue.tryPush(i));
+        }
+        FLOW_CHECK(!queue.tryPush(4));
+        FLOW_CHECK(queue.size() == 4);
+        for (int i = 0; i < 4; ++i) {
+            FLOW_CHECK(queue.tryPop(value));
+            FLOW_CHECK(value == i);
+        }
+        FLOW_CHECK(queue.empty());
+        // Wraps around the ring.
+        for (int round = 0; round < 10; ++round) {
+            FLOW_CHECK(queue.tryPush(round));
+            FLOW_CHECK(queue.tryPop(value) && value == round);
+        }
+    }
+
+    void movesOnlyValues() {
+        MPMCQueue<std::unique_ptr<int>> queue(2);
+        FLOW_CHECK(queue.tryPush(std::make_unique<int>(3)));
+        std::unique_ptr<int> value;
+        FLOW_CHECK(queue.tryPop(value) && *value == 3);
+    }
+
+    void timedVariantsTimeOut() {
+        MPMCQueue<int> queue(2);
+        int value = 0;
+        FLOW_CHECK(!queue.popFor(value, milliseconds(5)));
+        FLOW_CHECK(queue.pushFor(1, milliseconds(5)));
+        FLOW_CHECK(queue.pushFor(2, milliseconds(5)));
+        FLOW_CHECK(!queue.pushFor(3, milliseconds(5)));
+        FLOW_CHECK(queue.popFor(value, milliseconds(5)) && value == 1);
+    }
+
+    void blockingPopWakesOnPush() {
+        MPMCQueue<int> queue(2);
+        std::atomic_int popped = {0};
+        std::thread consumer([&] {
+            int value = 0;
+            queue.pop(value);
+            popped = value;
+        });
+        std::this_thread::sleep_for(milliseconds(10));
+        queue.push(42);
+        consumer.join();
+        FLOW_CHECK(popped == 42);
+    }
+
+    void blockingPushWakesOnPop() {
+        MPMCQueue<int> queue(2);
+        queue.push(1);
+        queue.push(2);
+        std::atomic_bool pushed = {false};
+        std::thread producer([&] {
+            queue.push(3);
+            pushed = true;
+        });
+        std::this_thread::sleep_for(milliseconds(10));
+        FLOW_CHECK(!pushed);
+        int value = 0;
+        queue.pop(value);
+        producer.join();
+        FLOW_CHECK(pushed);
+    }
+
+    // Every value pushed by any producer is popped exactly once.
+    void manyProducersAndConsumers() {
+        constexpr int producers = 4;
+        constexpr int consumers = 4;
+        constexpr int perProducer = 50000;
+        MPMCQueue<int> queue(64);
+        std::vector<std::atomic_int> seen(producers * perProducer);
+        std::atomic_int remaining = {producers * perProducer};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                for (int i = 0; i < perProducer; ++i) {
+                    queue.push(p * perProducer + i);
+                }
+            });
+        }
+        for (int c = 0; c < consumers; ++c) {
+            threads.emplace_back([&] {
+                int value = 0;
+                while (remaining > 0) {
+                    if (queue.popFor(value, milliseconds(1))) {
+                        ++seen[value];
+                        --remaining;
+                    }
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        bool once = true;
+        for (auto &count: seen) {
+            once = once && count == 1;
+        }
+        FLOW_CHECK(once);
+        FLOW_CHECK(queue.empty());
+    }
+
+    void taskQueueStores() {
+        for (const TaskStore store: {TaskStore::LOCKED_QUEUE, TaskStore::LOCK_FREE_RING}) {
+            TaskQueue<int> queue(store, 2);
+            FLOW_CHECK(queue.getStore() == store);
+            FLOW_CHECK(queue.tryPush(1) && queue.tryPush(2));
+            // Only the ring is bounded.
+            FLOW_CHECK(queue.tryPush(3) == (store == TaskStore::LOCKED_QUEUE));
+            int value = 0;
+            FLOW_CHECK(queue.tryPop(value) && value == 1);
+        }
+    }
+}
+
+int main() {
+    roundsCapacityUp();
+    fifoUntilFull();
+    movesOnlyValues();
+    timedVariantsTimeOut();
+    blockingPopWakesOnPush();
+    blockingPushWakesOnPop();
+    manyProducersAndConsumers();
+    taskQueueStores();
+    return FlowTest::result();
+}
@@ -0,0 +1,112 @@
+#include "IdleManager.h"
+#include "ObjectPool.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    void checksOutEveryObjectOnce() {
+        int built = 0;
+        ObjectPool<int> pool(4, [&] {
+            return built++;
+        });
+        FLOW_CHECK(pool.size() == 4 && built == 4);
+        std::vector<ObjectPool<int>::Handle> handles;
+        std::set<int> seen;
+        for (int i = 0; i < 4; ++i) {
+            handles.push_back(pool.tryAcquire());
+            FLOW_CHECK(static_cast<bool>(handles.back()));
+            seen.insert(*handles.back());
+        }
+        FLOW_CHECK(seen.size() == 4);
+        FLOW_CHECK(!pool.tryAcquire());
+        const auto start = std::chrono::steady_clock::now();
+        FLOW_CHECK(!pool.tryAcquireFor(milliseconds(10)));
+        FLOW_CHECK(std::chrono::steady_clock::now() - start >= milliseconds(10));
+
+        // Moving keeps the checkout, reset() hands it back.
+        ObjectPool<int>::Handle moved = std::move(handles[0]);
+        FLOW_CHECK(!handles[0] && moved);
+        moved.reset();
+        FLOW_CHECK(!moved);
+        FLOW_CHECK(static_cast<bool>(pool.tryAcquire()));
+    }
+
+    void acquireWaitsForRelease() {
+        ObjectPool<int> pool(1);
+        auto held = pool.acquire();
+        std::atomic_bool acquired = {false};
+        std::thread waiter([&] {
+            const auto handle = pool.acquire();
+            acquired = static_cast<bool>(handle);
+        });
+        std::this_thread::sleep_for(milliseconds(20));
+        FLOW_CHECK(!acquired);
+        held.reset();
+        waiter.join();
+        FLOW_CHECK(acquired);
+    }
+
+    // More threads than objects; an object must never be held twice.
+    void neverHandsOutTwice() {
+        struct Slot {
+            std::atomic_bool inUse = {false};
+        };
+        ObjectPool<Slot> pool(3);
+        std::atomic_size_t doubled = {0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 6; ++t) {
+            threads.emplace_back([&, t] {
+                for (int i = 0; i < 20000; ++i) {
+                    auto handle = (i + t) % 3 == 0 ? pool.tryAcquireFor(milliseconds(100)) : pool.acquire();
+                    if (!handle) {
+                        continue;
+                    }
+                    if (handle->inUse.exchange(true)) {
+                        ++doubled;
+                    }
+                    handle->inUse = false;
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        FLOW_CHECK(doubled == 0);
+        std::vector<ObjectPool<Slot>::Handle> all;
+        for (int i = 0; i < 3; ++i) {
+            all.push_back(pool.tryAcquire());
+        }
+        FLOW_CHECK(all[0] && all[1] && all[2]);
+    }
+
+    void idleManagerHandsBack() {
+        IdleManager<int> manager;
+        manager.add(std::make_shared<int>(5));
+        auto object = manager.get();
+        FLOW_CHECK(*object->object == 5);
+        std::atomic_bool acquired = {false};
+        std::thread waiter([&] {
+            const auto again = manager.get();
+            acquired = true;
+        });
+        std::this_thread::sleep_for(milliseconds(20));
+        FLOW_CHECK(!acquired);
+        object.reset();
+        waiter.join();
+        FLOW_CHECK(acquired);
+    }
+}
+
+int main() {
+    checksOutEveryObjectOnce();
+    acquireWaitsForRelease();
+    neverHandsOutTwice();
+    idleManagerHandsBack();
+    return FlowTest::result();
+}
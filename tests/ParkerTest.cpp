@@ -0,0 +1,101 @@
+#include "FlowLog.h"
+#include "Parker.h"
+#include "WorkerPool.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+    using std::chrono::milliseconds;
+    using std::chrono::microseconds;
+
+    void permitBeforeParkIsKept() {
+        Parker parker;
+        parker.unpark();
+        FLOW_CHECK(parker.parkFor(milliseconds(0)));
+        FLOW_CHECK(!parker.parkFor(milliseconds(5)));
+    }
+
+    void permitsDoNotAccumulate() {
+        Parker parker;
+        parker.unpark();
+        parker.unpark();
+        FLOW_CHECK(parker.parkFor(milliseconds(0)));
+        FLOW_CHECK(!parker.parkFor(milliseconds(1)));
+    }
+
+    void parkForTimesOut() {
+        for (const auto window: {microseconds(0), microseconds(500)}) {
+            Parker parker(window);
+            const auto start = std::chrono::steady_clock::now();
+            FLOW_CHECK(!parker.parkFor(milliseconds(10)));
+            FLOW_CHECK(std::chrono::steady_clock::now() - start >= milliseconds(10));
+        }
+    }
+
+    void unparkWakesSleeper() {
+        Parker parker;
+        std::atomic_bool woke = {false};
+        std::thread sleeper([&] {
+            parker.park();
+            woke = true;
+        });
+        std::this_thread::sleep_for(milliseconds(10));
+        FLOW_CHECK(!woke);
+        parker.unpark();
+        sleeper.join();
+        FLOW_CHECK(woke);
+    }
+
+    // No wake up is lost however park and unpark interleave.
+    void pingPong() {
+        for (const auto window: {microseconds(0), microseconds(20)}) {
+            Parker ping(window);
+            Parker pong(window);
+            constexpr int rounds = 20000;
+            std::thread partner([&] {
+                for (int i = 0; i < rounds; ++i) {
+                    ping.park();
+                    pong.unpark();
+                }
+            });
+            for (int i = 0; i < rounds; ++i) {
+                ping.unpark();
+                pong.park();
+            }
+            partner.join();
+        }
+    }
+
+    // Every task runs exactly once whether workers drain the store or go idle after each task.
+    void poolRunsEveryTask() {
+        for (const TaskStore store: {TaskStore::LOCKED_QUEUE, TaskStore::LOCK_FREE_RING}) {
+            for (const bool batchDrain: {false, true}) {
+                WorkerPool pool(4, store, 1 << 16);
+                pool.setBatchDrain(batchDrain);
+                pool.setSpinWindow(microseconds(batchDrain ? 20 : 0));
+                std::atomic_int runs = {0};
+                constexpr int count = 20000;
+                pool.start();
+                for (int i = 0; i < count; ++i) {
+                    pool.addTask(InlineTask([&runs] { ++runs; }));
+                }
+                pool.start();
+                pool.wait();
+                FLOW_CHECK(runs == count);
+                FLOW_CHECK(pool.getExecutedCount() == count);
+            }
+        }
+    }
+}
+
+int main() {
+    permitBeforeParkIsKept();
+    permitsDoNotAccumulate();
+    parkForTimesOut();
+    unparkWakesSleeper();
+    pingPong();
+    poolRunsEveryTask();
+    return FlowTest::result();
+}
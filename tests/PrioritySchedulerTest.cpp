@@ -0,0 +1,170 @@
+#include "FlowLog.h"
+#include "PriorityScheduler.h"
+#include "PriorityWorkerPool.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    std::vector<int> drain(PriorityScheduler<int> &scheduler) {
+        std::vector<int> popped;
+        int value;
+        while (scheduler.tryPop(value)) {
+            popped.push_back(value);
+        }
+        return popped;
+    }
+
+    void highestFirstFifoWithin() {
+        PriorityScheduler<int> scheduler(8);
+        scheduler.push(10, 1);
+        scheduler.push(30, 3);
+        scheduler.push(11, 1);
+        scheduler.push(31, 3);
+        scheduler.push(0, 0);
+        FLOW_CHECK(scheduler.highestPending() == 3);
+        FLOW_CHECK(scheduler.size() == 5);
+        FLOW_CHECK((drain(scheduler) == std::vector<int>{30, 31, 10, 11, 0}));
+        FLOW_CHECK(scheduler.empty());
+        FLOW_CHECK(scheduler.highestPending() == -1);
+    }
+
+    void clampsToTopLevel() {
+        PriorityScheduler<int> scheduler(4);
+        FLOW_CHECK(scheduler.toLevel(100) == 3);
+        scheduler.push(1, 100);
+        scheduler.push(2, 3);
+        FLOW_CHECK((drain(scheduler) == std::vector<int>{1, 2}));
+    }
+
+    void spillsInOrder() {
+        PriorityScheduler<int> scheduler(2, 2);
+        FLOW_CHECK(scheduler.tryPush(0, 1));
+        FLOW_CHECK(scheduler.tryPush(1, 1));
+        FLOW_CHECK(!scheduler.tryPush(2, 1));
+        for (int i = 2; i < 6; ++i) {
+            scheduler.push(i, 1);
+        }
+        int value;
+        FLOW_CHECK(scheduler.tryPop(value) && value == 0);
+        // The ring has room again, but the level keeps its order through the overflow list.
+        scheduler.push(6, 1);
+        FLOW_CHECK((drain(scheduler) == std::vector<int>{1, 2, 3, 4, 5, 6}));
+    }
+
+    void agingServesLowest() {
+        PriorityScheduler<int> scheduler(4, 16, 3);
+        for (int i = 0; i < 4; ++i) {
+            scheduler.push(30 + i, 3);
+        }
+        scheduler.push(0, 0);
+        const auto popped = drain(scheduler);
+        FLOW_CHECK((popped == std::vector<int>{30, 31, 0, 32, 33}));
+    }
+
+    void popAboveSkipsLowerLevels() {
+        PriorityScheduler<int> scheduler(8);
+        scheduler.push(2, 2);
+        scheduler.push(5, 5);
+        int value;
+        size_t level;
+        FLOW_CHECK(scheduler.tryPopAbove(value, 2, level) && value == 5 && level == 5);
+        FLOW_CHECK(!scheduler.tryPopAbove(value, 2, level));
+        FLOW_CHECK(scheduler.tryPopLowest(value) && value == 2);
+    }
+
+    // Every value pushed by any producer comes out exactly once.
+    void concurrentPushPop() {
+        constexpr int producers = 4;
+        constexpr int perProducer = 20000;
+        PriorityScheduler<int> scheduler(4, 64);
+        std::vector<std::atomic_int> seen(producers * perProducer);
+        std::atomic_int remaining = {producers * perProducer};
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p] {
+                for (int i = 0; i < perProducer; ++i) {
+                    scheduler.push(p * perProducer + i, p);
+                }
+            });
+        }
+        for (int c = 0; c < 2; ++c) {
+            threads.emplace_back([&] {
+                int value;
+                while (remaining > 0) {
+                    if (!scheduler.tryPop(value)) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    ++seen[value];
+                    --remaining;
+                }
+            });
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        bool once = true;
+        for (auto &count: seen) {
+            once = once && count == 1;
+        }
+        FLOW_CHECK(once);
+        FLOW_CHECK(scheduler.empty());
+    }
+
+    // A single worker held busy sees the queued tasks by priority, FIFO within one.
+    void poolRunsByPriority() {
+        PriorityWorkerPool pool(1, 0, 8);
+        std::atomic_bool started = {false};
+        std::atomic_bool released = {false};
+        pool.addTask(InlineTask([&] {
+            started = true;
+            while (!released) {
+                std::this_thread::yield();
+            }
+        }), 7);
+        pool.start();
+        FLOW_CHECK(FlowTest::waitFor([&] { return started.load(); }));
+        std::mutex orderMutex;
+        std::vector<int> order;
+        for (const int priority: {1, 5, 3, 5, 1}) {
+            pool.addTask(InlineTask([&, priority] {
+                std::lock_guard<std::mutex> guard(orderMutex);
+                order.push_back(priority);
+            }), priority);
+        }
+        released = true;
+        pool.start();
+        pool.join();
+        FLOW_CHECK((order == std::vector<int>{5, 5, 3, 1, 1}));
+    }
+
+    // Tasks whose token is cancelled are shed when dequeued instead of run.
+    void poolShedsCancelled() {
+        PriorityWorkerPool pool(2);
+        const auto cancelled = CancellationToken::create();
+        cancelled.cancel();
+        std::atomic_int runs = {0};
+        for (int i = 0; i < 30; ++i) {
+            pool.addTask(InlineTask([&runs] { ++runs; }), i, i % 2 ? cancelled : CancellationToken());
+        }
+        pool.join();
+        FLOW_CHECK(runs == 15);
+        FLOW_CHECK(pool.getShedCount() == 15);
+        FLOW_CHECK(pool.getExecutedCount() == 15);
+    }
+}
+
+int main() {
+    highestFirstFifoWithin();
+    clampsToTopLevel();
+    spillsInOrder();
+    agingServesLowest();
+    popAboveSkipsLowerLevels();
+    concurrentPushPop();
+    poolRunsByPriority();
+    poolShedsCancelled();
+    return FlowTest::result();
+}
@@ -0,0 +1,84 @@
+#include "FlowLog.h"
+#include "PriorityThreadPool.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    void runsEveryFunction() {
+        for (const bool persistent: {false, true}) {
+            PriorityThreadPool pool(4, persistent);
+            std::atomic_int runs = {0};
+            for (int i = 0; i < 2000; ++i) {
+                pool.addFunction(InlineTask([&runs] { ++runs; }), i % 7);
+            }
+            pool.start();
+            pool.join();
+            FLOW_CHECK(runs == 2000);
+        }
+    }
+
+    // With its single thread busy, a persistent pool starts the queued functions by priority.
+    void persistentRunsByPriority() {
+        PriorityThreadPool pool(1, true);
+        std::atomic_bool started = {false};
+        std::atomic_bool released = {false};
+        pool.addFunction(InlineTask([&] {
+            started = true;
+            while (!released) {
+                std::this_thread::yield();
+            }
+        }), 0);
+        FLOW_CHECK(FlowTest::waitFor([&] { return started.load(); }));
+        std::mutex orderMutex;
+        std::vector<int> order;
+        for (const int priority: {1, 9, 4, 9}) {
+            pool.addFunction(InlineTask([&, priority] {
+                std::lock_guard<std::mutex> guard(orderMutex);
+                order.push_back(priority);
+            }), priority);
+        }
+        released = true;
+        pool.join();
+        FLOW_CHECK((order == std::vector<int>{9, 9, 4, 1}));
+    }
+
+    // A long function that reaches a preemption point lets queued urgent functions run first.
+    void yieldRunsHigherPriority() {
+        FLOW_CHECK(!PriorityThreadPool::yieldIfHigherPriorityPending());
+        PriorityThreadPool pool(1, true);
+        std::atomic_bool started = {false};
+        std::atomic_bool queued = {false};
+        std::mutex orderMutex;
+        std::vector<int> order;
+        auto record = [&](const int value) {
+            std::lock_guard<std::mutex> guard(orderMutex);
+            order.push_back(value);
+        };
+        pool.addFunction(InlineTask([&] {
+            started = true;
+            while (!queued) {
+                std::this_thread::yield();
+            }
+            record(1);
+            FLOW_CHECK(PriorityThreadPool::yieldIfHigherPriorityPending());
+            record(2);
+        }), 3);
+        FLOW_CHECK(FlowTest::waitFor([&] { return started.load(); }));
+        pool.addFunction(InlineTask([&] { record(0); }), 1);
+        pool.addFunction(InlineTask([&] { record(10); }), 10);
+        queued = true;
+        pool.join();
+        // The priority 1 function is not more urgent, so it waits for the long one to finish.
+        FLOW_CHECK((order == std::vector<int>{1, 10, 2, 0}));
+    }
+}
+
+int main() {
+    runsEveryFunction();
+    persistentRunsByPriority();
+    yieldRunsHigherPriority();
+    return FlowTest::result();
+}
@@ -0,0 +1,132 @@
+#include "ReaderWriterLock.h"
+#include "SeqLock.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    using std::chrono::milliseconds;
+
+    void readersShareWritersExclude() {
+        ReaderWriterLock lock(4);
+        {
+            const auto first = lock.read();
+            std::thread other([&] {
+                // A second reader on another thread gets in, a writer does not.
+                FLOW_CHECK(lock.try_lock_shared());
+                lock.unlock_shared();
+                FLOW_CHECK(!lock.try_lock());
+            });
+            other.join();
+        }
+        FLOW_CHECK(lock.try_lock());
+        std::thread other([&] {
+            FLOW_CHECK(!lock.try_lock_shared());
+        });
+        other.join();
+        lock.unlock();
+    }
+
+    void writerWaitsForReaders() {
+        ReaderWriterLock lock;
+        std::atomic_bool written = {false};
+        auto reader = lock.read();
+        std::thread writer([&] {
+            const auto guard = lock.write();
+            written = true;
+        });
+        std::this_thread::sleep_for(milliseconds(20));
+        FLOW_CHECK(!written);
+        reader.unlock();
+        writer.join();
+        FLOW_CHECK(written);
+    }
+
+    // Writers keep both halves equal; a reader that ever sees them differ got in during a write.
+    void readersSeeWholeWrites() {
+        ReaderWriterLock lock(2);
+        long first = 0;
+        long second = 0;
+        std::atomic_bool done = {false};
+        std::atomic_size_t torn = {0};
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 4; ++i) {
+            readers.emplace_back([&] {
+                while (!done) {
+                    const std::shared_lock<ReaderWriterLock> guard(lock);
+                    if (first != second) {
+                        ++torn;
+                    }
+                }
+            });
+        }
+        for (int i = 0; i < 20000; ++i) {
+            const std::lock_guard<ReaderWriterLock> guard(lock);
+            ++first;
+            if (i % 64 == 0) {
+                std::this_thread::yield();
+            }
+            ++second;
+        }
+        done = true;
+        for (auto &reader: readers) {
+            reader.join();
+        }
+        FLOW_CHECK(torn == 0);
+        FLOW_CHECK(first == 20000 && second == 20000);
+    }
+
+    struct Snapshot {
+        uint64_t a = 0;
+        uint64_t b = 0;
+        uint32_t c = 0;
+    };
+
+    void seqLockSnapshots() {
+        SeqLock<Snapshot> lock(Snapshot{1, 1, 1});
+        FLOW_CHECK(lock.load().a == 1 && lock.load().c == 1);
+        {
+            auto writer = lock.modify();
+            writer->a = 2;
+            // Readers keep seeing the old value until the writer goes away.
+            FLOW_CHECK(lock.load().a == 1);
+        }
+        FLOW_CHECK(lock.load().a == 2 && lock.load().b == 1);
+        lock.store(Snapshot{});
+
+        std::atomic_bool done = {false};
+        std::atomic_size_t torn = {0};
+        std::vector<std::thread> readers;
+        for (int i = 0; i < 3; ++i) {
+            readers.emplace_back([&] {
+                while (!done) {
+                    const Snapshot value = lock.load();
+                    if (value.a != value.b || value.b != value.c) {
+                        ++torn;
+                    }
+                }
+            });
+        }
+        for (uint32_t i = 0; i < 50000; ++i) {
+            lock.store(Snapshot{i, i, i});
+        }
+        done = true;
+        for (auto &reader: readers) {
+            reader.join();
+        }
+        FLOW_CHECK(torn == 0);
+        FLOW_CHECK(lock.load().c == 49999);
+    }
+}
+
+int main() {
+    readersShareWritersExclude();
+    writerWaitsForReaders();
+    readersSeeWholeWrites();
+    seqLockSnapshots();
+    return FlowTest::result();
+}
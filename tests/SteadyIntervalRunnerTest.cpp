@@ -0,0 +1,187 @@
+#include "FlowLog.h"
+#include "SteadyIntervalRunner.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Virtual time: waiting jumps the clock straight to the deadline, and toRun moves it forward to
+    // simulate a run that takes that long. Schedules are checked exactly and without sleeping.
+    struct FakeClock {
+        using duration = std::chrono::milliseconds;
+        using rep = duration::rep;
+        using period = duration::period;
+        using time_point = std::chrono::time_point<FakeClock>;
+        static constexpr bool is_steady = true;
+
+        static time_point now() {
+            return time_point(duration(ticks.load()));
+        }
+
+        static void advance(const duration &by) {
+            ticks += by.count();
+        }
+
+        static void reset() {
+            ticks = 0;
+        }
+
+        static void waitUntil(std::condition_variable &, std::unique_lock<std::mutex> &, const time_point &deadline) {
+            rep current = ticks.load();
+            while (current < deadline.time_since_epoch().count() &&
+                   !ticks.compare_exchange_weak(current, deadline.time_since_epoch().count())) {}
+        }
+
+        inline static std::atomic<rep> ticks = {0};
+    };
+
+    using Runner = SteadyIntervalRunner<FakeClock>;
+    using std::chrono::milliseconds;
+
+    // Runs toRun, which records the start and returns true to keep going, until it stops the runner.
+    struct Recorder {
+        std::vector<FakeClock::rep> starts;
+        std::function<bool(size_t run)> onRun;
+
+        std::function<void()> toRun(Runner *&runner) {
+            return [this, &runner] {
+                starts.push_back(FakeClock::now().time_since_epoch().count());
+                if (!onRun(starts.size())) {
+                    runner->Stop();
+                }
+            };
+        }
+    };
+
+    std::vector<FakeClock::rep> runStarts(const Runner::MissedTicks &missedTicks, const std::function<bool(size_t)> &onRun,
+                                          Runner::Stats *stats = nullptr, const milliseconds &jitter = {}) {
+        FakeClock::reset();
+        Recorder recorder{{}, onRun};
+        Runner *runner = nullptr;
+        Runner steady(recorder.toRun(runner), milliseconds(10), milliseconds(5), missedTicks, false, jitter);
+        runner = &steady;
+        steady.Run();
+        steady.Join();
+        if (stats != nullptr) {
+            *stats = steady.getStats();
+        }
+        return recorder.starts;
+    }
+
+    void runsOnGrid() {
+        Runner::Stats stats;
+        const auto starts = runStarts(Runner::MissedTicks::SKIP, [](size_t run) {
+            FakeClock::advance(milliseconds(3));
+            return run < 4;
+        }, &stats);
+        FLOW_CHECK((starts == std::vector<FakeClock::rep>{5, 15, 25, 35}));
+        FLOW_CHECK(stats.runs == 4);
+        FLOW_CHECK(stats.missed == 0);
+        FLOW_CHECK(stats.maxLateness == milliseconds(0));
+        FLOW_CHECK(stats.maxDuration == milliseconds(3));
+    }
+
+    // The first run takes 32ms, overrunning the grid points at 15, 25 and 35.
+    bool overrunFirst(const size_t &run) {
+        if (run == 1) {
+            FakeClock::advance(milliseconds(32));
+        }
+        return run < 5;
+    }
+
+    void skipsMissedTicks() {
+        Runner::Stats stats;
+        const auto starts = runStarts(Runner::MissedTicks::SKIP, overrunFirst, &stats);
+        FLOW_CHECK((starts == std::vector<FakeClock::rep>{5, 45, 55, 65, 75}));
+        FLOW_CHECK(stats.missed == 3);
+    }
+
+    void catchesUpMissedTicks() {
+        Runner::Stats stats;
+        const auto starts = runStarts(Runner::MissedTicks::CATCH_UP, overrunFirst, &stats);
+        FLOW_CHECK((starts == std::vector<FakeClock::rep>{5, 37, 37, 37, 45}));
+        FLOW_CHECK(stats.missed == 0);
+        FLOW_CHECK(stats.maxLateness == milliseconds(22));
+    }
+
+    void coalescesMissedTicks() {
+        Runner::Stats stats;
+        const auto starts = runStarts(Runner::MissedTicks::COALESCE, overrunFirst, &stats);
+        FLOW_CHECK((starts == std::vector<FakeClock::rep>{5, 37, 45, 55, 65}));
+        FLOW_CHECK(stats.missed == 2);
+    }
+
+    void jitterStaysWithinBound() {
+        Runner::Stats stats;
+        const auto starts = runStarts(Runner::MissedTicks::SKIP, [](size_t run) {
+            return run < 100;
+        }, &stats, milliseconds(4));
+        FLOW_CHECK(starts.size() == 100);
+        bool varied = false;
+        for (size_t run = 0; run < starts.size(); ++run) {
+            const FakeClock::rep offset = starts[run] - (5 + 10 * static_cast<FakeClock::rep>(run));
+            FLOW_CHECK(offset >= 0 && offset <= 4);
+            varied = varied || offset != starts[0] - 5;
+        }
+        FLOW_CHECK(varied);
+        // Lateness counts from the jittered start, which the fake clock hits exactly.
+        FLOW_CHECK(stats.maxLateness == milliseconds(0));
+    }
+
+    void singleRun() {
+        FakeClock::reset();
+        std::atomic_int runs = {0};
+        Runner runner([&] { ++runs; }, milliseconds(10), milliseconds(5), Runner::MissedTicks::SKIP, true);
+        runner.Run();
+        runner.Join();
+        FLOW_CHECK(runs == 1);
+        FLOW_CHECK(!runner.isRunning());
+    }
+
+    void restartsRightAfterStop() {
+        FakeClock::reset();
+        std::atomic_int runs = {0};
+        std::atomic_bool inFirstRun = {false};
+        std::atomic_bool released = {false};
+        Runner *runner = nullptr;
+        Runner steady([&] {
+            if (++runs == 1) {
+                inFirstRun = true;
+                while (!released) {
+                    std::this_thread::yield();
+                }
+            } else if (runs == 3) {
+                runner->Stop();
+            }
+        }, milliseconds(10), milliseconds(0));
+        runner = &steady;
+        steady.Run();
+        FLOW_CHECK(FlowTest::waitFor([&] { return inFirstRun.load(); }));
+        std::thread releaser([&] {
+            std::this_thread::sleep_for(milliseconds(20));
+            released = true;
+        });
+        // The old loop is still inside its run; Run() has to wait it out and start a new one.
+        steady.Stop();
+        steady.Run();
+        releaser.join();
+        FLOW_CHECK(FlowTest::waitFor([&] { return runs.load() >= 3; }));
+        steady.Join();
+        FLOW_CHECK(runs == 3);
+    }
+}
+
+int main() {
+    runsOnGrid();
+    skipsMissedTicks();
+    catchesUpMissedTicks();
+    coalescesMissedTicks();
+    jitterStaysWithinBound();
+    singleRun();
+    restartsRightAfterStop();
+    return FlowTest::result();
+}
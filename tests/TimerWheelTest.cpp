@@ -0,0 +1,179 @@
+#include "FlowLog.h"
+#include "TimerWheel.h"
+#include "WorkerPool.h"
+#include "FlowTest.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace {
+    using std::chrono::milliseconds;
+    using std::chrono::microseconds;
+    using Clock = std::chrono::steady_clock;
+
+    // A fine tick spreads the delays over every level, so timers have to cascade down to fire.
+    void manyTimersFireOnceAndNeverEarly() {
+        constexpr int count = 20000;
+        TimerWheel wheel(microseconds(10));
+        std::vector<Clock::time_point> due(count);
+        std::vector<Clock::time_point> fired(count);
+        std::vector<TimerWheel::TimerId> ids(count);
+        std::atomic_int runs = {0};
+        std::minstd_rand random(1);
+        for (int i = 0; i < count; ++i) {
+            const auto delay = milliseconds(300 + random() % 700);
+            due[i] = Clock::now() + delay;
+            ids[i] = wheel.schedule([&, i] {
+                fired[i] = Clock::now();
+                ++runs;
+            }, delay);
+        }
+        // A slow run (sanitizers) may let some fire first; those simply fail to cancel.
+        int cancelled = 0;
+        for (int i = 0; i < 1000; ++i) {
+            cancelled += wheel.cancel(ids[i]);
+        }
+        FLOW_CHECK(cancelled > 0);
+        for (int i = 1000; i < 2000; ++i) {
+            const auto rescheduledDue = Clock::now() + milliseconds(20);
+            if (wheel.reschedule(ids[i], milliseconds(20))) {
+                due[i] = rescheduledDue;
+            }
+        }
+        FLOW_CHECK(FlowTest::waitFor([&] {
+            return runs == count - cancelled;
+        }, std::chrono::seconds(10)));
+        FLOW_CHECK(wheel.size() == 0);
+        int early = 0;
+        for (int i = 0; i < count; ++i) {
+            early += fired[i] != Clock::time_point() && fired[i] < due[i];
+        }
+        FLOW_CHECK(early == 0);
+        FLOW_CHECK(!wheel.cancel(ids[0]) && !wheel.cancel(ids[count - 1]));
+    }
+
+    void fixedRateTracksDrift() {
+        TimerWheel wheel;
+        std::atomic_int runs = {0};
+        const auto id = wheel.schedule([&] {
+            ++runs;
+        }, milliseconds(10), milliseconds(10));
+        FLOW_CHECK(FlowTest::waitFor([&] {
+            return runs >= 10;
+        }));
+        const auto drift = wheel.getDrift(id);
+        FLOW_CHECK(drift && drift->runs >= 10 && drift->skipped == 0);
+        FLOW_CHECK(drift && drift->max >= drift->mean());
+        FLOW_CHECK(wheel.cancel(id));
+        FLOW_CHECK(!wheel.cancel(id) && !wheel.getDrift(id));
+    }
+
+    // The run takes as long as the period, so FIXED_DELAY starts one about every two periods.
+    void fixedDelayThroughPool() {
+        WorkerPool pool(2);
+        TimerWheel wheel(milliseconds(1), [&](InlineTask task) {
+            pool.addTask(std::move(task));
+            pool.start();
+        });
+        std::atomic_int runs = {0};
+        const auto started = Clock::now();
+        const auto id = wheel.schedule([&] {
+            ++runs;
+            std::this_thread::sleep_for(milliseconds(10));
+        }, milliseconds(0), milliseconds(10), TimerWheel::Mode::FIXED_DELAY);
+        FLOW_CHECK(FlowTest::waitFor([&] {
+            return runs >= 5;
+        }));
+        FLOW_CHECK(Clock::now() - started >= milliseconds(80));
+        wheel.cancel(id);
+        wheel.stop();
+        pool.wait();
+    }
+
+    // A dispatched FIXED_RATE run that outlasts its period skips grid points instead of overlapping.
+    void dispatchedRunsNeverOverlap() {
+        std::mutex threadsMutex;
+        std::vector<std::thread> threads;
+        std::atomic_int inFlight = {0};
+        std::atomic_int overlaps = {0};
+        std::atomic_int runs = {0};
+        {
+            TimerWheel wheel(milliseconds(1), [&](InlineTask task) {
+                std::lock_guard<std::mutex> guard(threadsMutex);
+                threads.emplace_back([task = std::move(task)]() mutable {
+                    task();
+                });
+            });
+            const auto id = wheel.schedule([&] {
+                if (++inFlight > 1) {
+                    ++overlaps;
+                }
+                std::this_thread::sleep_for(milliseconds(25));
+                --inFlight;
+                ++runs;
+            }, milliseconds(5), milliseconds(10));
+            FLOW_CHECK(FlowTest::waitFor([&] {
+                return runs >= 4;
+            }));
+            const auto drift = wheel.getDrift(id);
+            FLOW_CHECK(drift && drift->skipped >= 2);
+            wheel.cancel(id);
+            wheel.stop();
+        }
+        std::lock_guard<std::mutex> guard(threadsMutex);
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        FLOW_CHECK(overlaps == 0);
+    }
+
+    void failedTimerKeepsWheelGoing() {
+        TimerWheel wheel;
+        std::atomic_int runs = {0};
+        wheel.schedule([] {
+            throw std::runtime_error("expected");
+        }, milliseconds(1));
+        wheel.schedule([&] {
+            ++runs;
+        }, milliseconds(5));
+        FLOW_CHECK(FlowTest::waitFor([&] {
+            return runs == 1;
+        }));
+    }
+
+    void stopWakesAtOnce() {
+        TimerWheel wheel;
+        std::atomic_bool ran = {false};
+        wheel.schedule([&] {
+            ran = true;
+        }, std::chrono::hours(100));
+        const auto started = Clock::now();
+        wheel.stop();
+        FLOW_CHECK(Clock::now() - started < milliseconds(500));
+        FLOW_CHECK(!ran);
+
+        // From a timer it only stops; the destructor joins.
+        TimerWheel selfStopping;
+        std::atomic_int runs = {0};
+        selfStopping.schedule([&] {
+            ++runs;
+            selfStopping.stop();
+        }, milliseconds(2), milliseconds(2));
+        std::this_thread::sleep_for(milliseconds(30));
+        FLOW_CHECK(runs == 1);
+    }
+}
+
+int main() {
+    manyTimersFireOnceAndNeverEarly();
+    fixedRateTracksDrift();
+    fixedDelayThroughPool();
+    dispatchedRunsNeverOverlap();
+    failedTimerKeepsWheelGoing();
+    stopWakesAtOnce();
+    return FlowTest::result();
+}